@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DualReceiver.ino
+ * Two DW1000 on one Arduino, each driven by its own DW1000Class instance:
+ * the default instance DW1000 listens on channel 5, a second one on channel 2.
+ * Both share SPI but have their own chip select, interrupt and reset line.
+ * Use the "BasicSender" example sketch (with the matching channel) as sender.
+ */
+
+#include <SPI.h>
+#include <DW1000.h>
+
+// connection pins of the first module
+const uint8_t PIN_RST = 9; // reset pin
+const uint8_t PIN_IRQ = 2; // irq pin
+const uint8_t PIN_SS = SS; // spi select pin
+// connection pins of the second module
+const uint8_t PIN_RST2 = 8; // reset pin
+const uint8_t PIN_IRQ2 = 3; // irq pin
+const uint8_t PIN_SS2 = 7;  // spi select pin
+
+// the second module, DW1000 drives the first one
+DW1000Class DW1000Second;
+
+// received status per module
+volatile boolean received = false;
+volatile boolean received2 = false;
+String message;
+
+void setup() {
+  // DEBUG monitoring
+  Serial.begin(9600);
+  Serial.println(F("### DW1000-arduino-dual-receiver ###"));
+  // initialize both drivers
+  DW1000.begin(PIN_IRQ, PIN_RST);
+  DW1000.select(PIN_SS);
+  if (!DW1000Second.begin(PIN_IRQ2, PIN_RST2)) {
+    Serial.println(F("No interrupt slot left for the second module, raise DW1000_MAX_INSTANCES"));
+  }
+  DW1000Second.select(PIN_SS2);
+  Serial.println(F("DW1000 initialized ..."));
+  // general configuration, channel 5 (default) and channel 2
+  configure(DW1000, DW1000.CHANNEL_5, DW1000.PREAMBLE_CODE_16MHZ_4);
+  configure(DW1000Second, DW1000.CHANNEL_2, DW1000.PREAMBLE_CODE_16MHZ_3);
+  Serial.println(F("Committed configuration ..."));
+  // attach callbacks for (successfully) received messages, one per module
+  DW1000.attachReceivedHandler(handleReceived);
+  DW1000Second.attachReceivedHandler(handleReceived2);
+  // start reception on both
+  receiver(DW1000);
+  receiver(DW1000Second);
+}
+
+void configure(DW1000Class& dw, byte channel, byte preambleCode) {
+  dw.newConfiguration();
+  dw.setDefaults();
+  dw.setDeviceAddress(6);
+  dw.setNetworkId(10);
+  dw.enableMode(DW1000.MODE_LONGDATA_RANGE_LOWPOWER);
+  dw.setChannel(channel);
+  dw.setPreambleCode(preambleCode);
+  dw.commitConfiguration();
+}
+
+void handleReceived() {
+  received = true;
+}
+
+void handleReceived2() {
+  received2 = true;
+}
+
+void receiver(DW1000Class& dw) {
+  dw.newReceive();
+  dw.setDefaults();
+  // so we don't need to restart the receiver manually
+  dw.receivePermanently(true);
+  dw.startReceive();
+}
+
+void printMessage(DW1000Class& dw, const char* name) {
+  dw.getData(message);
+  Serial.print("Received on "); Serial.print(name);
+  Serial.print(" ... "); Serial.println(message);
+  Serial.print("RX power is [dBm] ... "); Serial.println(dw.getReceivePower());
+}
+
+void loop() {
+  if (received) {
+    received = false;
+    printMessage(DW1000, "channel 5");
+  }
+  if (received2) {
+    received2 = false;
+    printMessage(DW1000Second, "channel 2");
+  }
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file SPIBenchmark.ino
+ * Measures the time of single register accesses to the DW1000 for typical
+ * payload sizes: 1 byte (status flag), 5 bytes (timestamp), 90 bytes
+ * (ranging message) and 1024 bytes (whole TX/RX buffer).
+ * Compare runs with DW1000_SPI_BURST set true and false in DW1000CompileOptions.h.
+ *
+ * Additionally replays the register accesses an anchor performs between
+ * receiving a POLL and starting the delayed POLL_ACK, once with the former
+ * fixed chip select hold time of 5us and once with the configured one, to
+ * show the effect of setChipSelectHoldTime() on the ranging turnaround.
+ * Enable DW1000_SPI_STATS to see the number of SPI transactions as well.
+ *
+ * @todo
+ *  - move strings to flash (less RAM consumption)
+ */
+
+#include <SPI.h>
+#include <DW1000.h>
+
+// connection pins
+const uint8_t PIN_RST = 9; // reset pin
+const uint8_t PIN_IRQ = 2; // irq pin
+const uint8_t PIN_SS = SS; // spi select pin
+
+// accesses per measurement
+const uint16_t ROUNDS = 100;
+// payload sizes to measure
+const uint16_t SIZES[] = {1, 5, 90, LEN_TX_BUFFER};
+// ranging message length and reply delay (as in DW1000Ranging)
+const uint16_t LEN_RANGING = 90;
+const uint16_t REPLY_DELAY_US = 8000;
+
+byte buffer[LEN_TX_BUFFER];
+
+void setup() {
+  // DEBUG monitoring
+  Serial.begin(115200);
+  Serial.println(F("### DW1000-arduino-spi-benchmark ###"));
+  // initialize the driver
+  DW1000.begin(PIN_IRQ, PIN_RST);
+  DW1000.select(PIN_SS);
+  Serial.println(F("DW1000 initialized ..."));
+  DW1000.newConfiguration();
+  DW1000.setDefaults();
+  DW1000.commitConfiguration();
+  Serial.print(F("Burst transfers: ")); Serial.println(DW1000_SPI_BURST ? F("on") : F("off"));
+}
+
+float measureRead(uint16_t n) {
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < ROUNDS; i++) {
+    DW1000.readBytes(RX_BUFFER, NO_SUB, buffer, n);
+  }
+  return (float)(micros() - start) / ROUNDS;
+}
+
+float measureWrite(uint16_t n) {
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < ROUNDS; i++) {
+    DW1000.writeBytes(TX_BUFFER, NO_SUB, buffer, n);
+  }
+  return (float)(micros() - start) / ROUNDS;
+}
+
+// register accesses of an anchor from POLL received to POLL_ACK started
+void pollAckTurnaround() {
+  DW1000Time timeReceived;
+  DW1000Time replyDelay(REPLY_DELAY_US, DW1000Time::MICROSECONDS);
+  DW1000.readSystemEventStatusRegister();
+  DW1000.clearReceiveStatus();
+  DW1000.getData(buffer, LEN_RANGING);
+  DW1000.getReceiveTimestamp(timeReceived);
+  DW1000.newTransmit();
+  DW1000.setDefaults();
+  DW1000.setDelay(replyDelay);
+  DW1000.setData(buffer, LEN_RANGING);
+  DW1000.startTransmit();
+  DW1000.idle();
+}
+
+float measureTurnaround(uint8_t holdUs, uint32_t* transactions) {
+  DW1000.setChipSelectHoldTime(holdUs);
+  DW1000.resetSpiStats();
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < ROUNDS; i++) {
+    pollAckTurnaround();
+  }
+  float elapsed = (float)(micros() - start) / ROUNDS;
+  *transactions = DW1000.getSpiTransactionCount() / ROUNDS;
+  return elapsed;
+}
+
+void loop() {
+  Serial.println(F("bytes\tread [us]\twrite [us]"));
+  for (uint8_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++) {
+    Serial.print(SIZES[i]); Serial.print('\t');
+    Serial.print(measureRead(SIZES[i])); Serial.print('\t');
+    Serial.println(measureWrite(SIZES[i]));
+  }
+  Serial.println();
+  uint32_t transactions;
+  Serial.println(F("cs hold [us]\tPOLL_ACK turnaround [us]\tSPI transactions"));
+  Serial.print(5); Serial.print('\t');
+  Serial.print(measureTurnaround(5, &transactions)); Serial.print('\t');
+  Serial.println(transactions);
+  Serial.print(DW1000_CS_HOLD_FAST_US); Serial.print('\t');
+  Serial.print(measureTurnaround(DW1000_CS_HOLD_FAST_US, &transactions)); Serial.print('\t');
+  Serial.println(transactions);
+  Serial.println();
+  delay(5000);
+}
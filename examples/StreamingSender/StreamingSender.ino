@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file StreamingSender.ino
+ * Use this to send bulk data as fast as the radio allows: frames are streamed back
+ * to back, the next one is uploaded while the current one is on air (see
+ * DW1000.streamData()). Complements the "BasicReceiver" example sketch, which
+ * prints the frames (its receiver has to be set to the same mode).
+ */
+#include <SPI.h>
+#include <DW1000.h>
+
+// connection pins
+const uint8_t PIN_RST = 9; // reset pin
+const uint8_t PIN_IRQ = 2; // irq pin
+const uint8_t PIN_SS = SS; // spi select pin
+
+// frame length, the first bytes carry the frame number
+const uint16_t FRAME_LEN = 100;
+byte frame[FRAME_LEN];
+
+// frames streamed (uploaded), sent (counted by the sent handler) and reported
+uint32_t streamedNum = 0;
+volatile uint32_t sentNum = 0;
+uint32_t reportedNum = 0;
+unsigned long reportTime = 0;
+
+void setup() {
+  // DEBUG monitoring
+  Serial.begin(9600);
+  Serial.println(F("### DW1000-arduino-streaming-sender ###"));
+  // initialize the driver
+  DW1000.begin(PIN_IRQ, PIN_RST);
+  DW1000.select(PIN_SS);
+  Serial.println(F("DW1000 initialized ..."));
+  // general configuration, 6.8 Mb/s with short preamble
+  DW1000.newConfiguration();
+  DW1000.setDefaults();
+  DW1000.setDeviceAddress(6);
+  DW1000.setNetworkId(10);
+  DW1000.enableMode(DW1000.MODE_SHORTDATA_FAST_ACCURACY);
+  DW1000.commitConfiguration();
+  Serial.println(F("Committed configuration ..."));
+  char msg[128];
+  DW1000.getPrintableDeviceMode(msg);
+  Serial.print("Device mode: "); Serial.println(msg);
+  for (uint16_t i = 0; i < FRAME_LEN; i++) {
+    frame[i] = (byte)i;
+  }
+  // attach callback for (successfully) sent messages
+  DW1000.attachSentHandler(handleSent);
+  // the first frame goes on air at once, the second one waits in the other half of the buffer
+  streamNext();
+  streamNext();
+  reportTime = millis();
+}
+
+boolean streamNext() {
+  memcpy(frame, &streamedNum, sizeof(streamedNum));
+  if (!DW1000.streamData(frame, FRAME_LEN)) {
+    return false;
+  }
+  streamedNum++;
+  return true;
+}
+
+void handleSent() {
+  // the frame waiting is on air already, upload the one after it meanwhile
+  sentNum++;
+  streamNext();
+}
+
+void loop() {
+  if (millis() - reportTime < 1000) {
+    return;
+  }
+  // frames and throughput of the last second
+  uint32_t num = sentNum;
+  Serial.print("Frames sent ... "); Serial.print(num - reportedNum);
+  Serial.print(", kb/s ... "); Serial.println((num - reportedNum) * FRAME_LEN * 8 / (millis() - reportTime));
+  reportedNum = num;
+  reportTime = millis();
+}
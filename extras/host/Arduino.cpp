@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file Arduino.cpp
+ * Minimal Arduino core for host builds of the library (see include/Arduino.h).
+ */
+
+#include <Arduino.h>
+
+HardwareSerial Serial;
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index) const {
+	if(bufsize == 0) {
+		return;
+	}
+	unsigned int n = 0;
+	for(; n+1 < bufsize && index+n < _str.length(); n++) {
+		buf[n] = (unsigned char)_str[index+n];
+	}
+	buf[n] = 0;
+}
+
+size_t Print::write(const char* str) {
+	size_t n = 0;
+	while(*str) {
+		n += write((uint8_t)*str++);
+	}
+	return n;
+}
+
+size_t Print::print(long n, int base) {
+	if(n < 0 && base == DEC) {
+		return print('-')+print((unsigned long)-n, base);
+	}
+	return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+	char buf[8*sizeof(long)+1];
+	char* str = &buf[sizeof(buf)-1];
+	*str = '\0';
+	if(base < 2) {
+		base = 10;
+	}
+	do {
+		char c = n%base;
+		n /= base;
+		*--str = c < 10 ? c+'0' : c+'A'-10;
+	} while(n);
+	return write(str);
+}
+
+size_t Print::print(double n, int digits) {
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%.*f", digits, n);
+	return write(buf);
+}
+
+long random(long howbig) {
+	if(howbig == 0) {
+		return 0;
+	}
+	return rand()%howbig;
+}
+
+long random(long howsmall, long howbig) {
+	if(howsmall >= howbig) {
+		return howsmall;
+	}
+	return random(howbig-howsmall)+howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+	if(seed != 0) {
+		srand(seed);
+	}
+}
+
+int analogRead(uint8_t /* pin */) {
+	return 0;
+}
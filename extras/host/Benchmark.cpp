@@ -0,0 +1,869 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file Benchmark.cpp
+ * Host benchmark of the driver on the simulated hardware (DW1000_HAL_SIM).
+ *
+ * Reports per operation the SPI transactions (chip select cycles), SPI bytes,
+ * interrupts and virtual time spent, i.e. numbers that do not depend on the
+ * machine the benchmark runs on.
+ */
+
+#include <DW1000.h>
+#include <DW1000Ranging.h>
+
+#if DW1000_HAL != DW1000_HAL_SIM
+#error "the benchmark runs on the simulated hardware, build with -DDW1000_HAL=DW1000_HAL_SIM"
+#endif
+
+// connection pins
+const uint8_t PIN_RST = 9;  // reset pin
+const uint8_t PIN_IRQ = 2;  // irq pin
+const uint8_t PIN_SS  = 10; // spi select pin
+
+// second chip, driven by its own instance
+const uint8_t PIN_RST2 = 7;
+const uint8_t PIN_IRQ2 = 3;
+const uint8_t PIN_SS2  = 8;
+DW1000Class DW1000Second;
+
+// third chip, without interrupt line
+const uint8_t PIN_RST3 = 6;
+const uint8_t PIN_SS3  = 5;
+DW1000Class DW1000Polled;
+
+// timeout for every step [ns]
+const uint64_t STEP_TIMEOUT = 100000000ULL;
+
+// SPI transactions of a ranging round (POLL -> POLL_ACK, RANGE -> RANGE_REPORT) with the messages in the
+// transmit buffer already: tracked, the benchmark fails if a change takes more (lower it when one takes fewer)
+const uint32_t RANGING_ROUND_TRANSACTIONS = 36;
+
+// typical current of the DW1000 with the receiver on and off (idle) [mA], for energy estimates
+const float RX_CURRENT  = 113.0f;
+const float IDLE_CURRENT = 18.0f;
+
+volatile boolean sentAck     = false;
+volatile boolean receivedAck = false;
+volatile uint16_t receivedFrames = 0;
+volatile boolean failedAck   = false;
+
+uint32_t lastTransactions;
+uint32_t lastBytes;
+uint32_t lastInterrupts;
+uint64_t lastTime;
+
+// frames sent by the simulated chip, as seen on air
+byte airFrame[LEN_EXT_UWB_FRAMES];
+uint16_t airFrameLength = 0;
+uint16_t airFrames      = 0;
+
+void handleSent() {
+	sentAck = true;
+}
+
+void handleReceived() {
+	receivedAck = true;
+	receivedFrames++;
+}
+
+// lengths of two frames as the deferred callbacks see them
+const uint16_t DEFERRED_LEN[2] = {20, 30};
+uint16_t deferredLength[2];
+
+void handleDeferredReceived() {
+	if(receivedFrames < 2) {
+		deferredLength[receivedFrames] = DW1000.getDataLength();
+	}
+	handleReceived();
+}
+
+// bulk data, frames sent one after the other from the sent handler
+const uint16_t BULK_FRAMES = 20;
+const uint16_t BULK_LEN    = 100;
+byte bulkFrame[BULK_LEN];
+volatile uint16_t bulkSent = 0;
+uint16_t bulkLeft = 0;
+
+void handleBulkSent() {
+	bulkSent++;
+	if(bulkLeft > 0) {
+		bulkLeft--;
+		DW1000.newTransmit();
+		DW1000.setDefaults();
+		DW1000.setData(bulkFrame, BULK_LEN);
+		DW1000.startTransmit();
+	}
+}
+
+void handleBulkStreamed() {
+	bulkSent++;
+	if(bulkLeft > 0 && DW1000.streamData(bulkFrame, BULK_LEN)) {
+		bulkLeft--;
+	}
+}
+
+// frames of the sketch queued at the ranging anchor, counted by their completion handler
+const uint8_t QUEUED_FRAMES = 3;
+uint8_t queuedSent = 0;
+
+void handleQueuedDone(boolean sent) {
+	if(sent) {
+		queuedSent++;
+	}
+}
+
+void handleReceiveFailed() {
+	failedAck = true;
+}
+
+void handleTransmit(uint8_t /* ss */, const byte data[], uint16_t n) {
+	memcpy(airFrame, data, n);
+	airFrameLength = n;
+	airFrames++;
+}
+
+void start() {
+	DW1000Sim::resetStats();
+	lastTime = DW1000Sim::now();
+}
+
+void report(const char* name, uint8_t ss = PIN_SS) {
+	printf("%-36s %6u %7u %5u %11.1f %9.1f\n", name, DW1000Sim::getTransactionCount(ss),
+	       DW1000Sim::getByteCount(ss), DW1000Sim::getInterruptCount(ss),
+	       (DW1000Sim::now()-lastTime)/1000.0, DW1000Sim::getAirTime(ss)/1000.0);
+}
+
+/* sums of several operations, e.g. all of a ranging round. */
+struct Totals {
+	uint32_t transactions;
+	uint32_t bytes;
+	uint32_t interrupts;
+	uint64_t airTime;
+};
+
+void addTo(Totals& totals, uint8_t ss = PIN_SS) {
+	totals.transactions += DW1000Sim::getTransactionCount(ss);
+	totals.bytes        += DW1000Sim::getByteCount(ss);
+	totals.interrupts   += DW1000Sim::getInterruptCount(ss);
+	totals.airTime      += DW1000Sim::getAirTime(ss);
+}
+
+void report(const char* name, const Totals& totals, uint64_t time) {
+	printf("%-36s %6u %7u %5u %11.1f %9.1f\n", name, totals.transactions, totals.bytes, totals.interrupts,
+	       time/1000.0, totals.airTime/1000.0);
+}
+
+/* advance virtual time until the flag is set, returns false on timeout. */
+boolean waitFor(volatile boolean& flag) {
+	uint64_t until = DW1000Sim::now()+STEP_TIMEOUT;
+	while(!flag && DW1000Sim::now() < until) {
+		DW1000Sim::advance(1000);
+	}
+	return flag;
+}
+
+/* send the bulk data, streamed or one frame at a time, returns false on timeout. */
+boolean sendBulk(boolean streamed) {
+	uint64_t until = DW1000Sim::now()+STEP_TIMEOUT;
+	bulkSent = 0;
+	bulkLeft = BULK_FRAMES-1;
+	if(streamed) {
+		// the first frame goes on air, the second one waits for it
+		DW1000.attachSentHandler(handleBulkStreamed);
+		DW1000.streamData(bulkFrame, BULK_LEN);
+		DW1000.streamData(bulkFrame, BULK_LEN);
+		bulkLeft--;
+	} else {
+		DW1000.attachSentHandler(handleBulkSent);
+		DW1000.newTransmit();
+		DW1000.setDefaults();
+		DW1000.setData(bulkFrame, BULK_LEN);
+		DW1000.startTransmit();
+	}
+	while(bulkSent < BULK_FRAMES && DW1000Sim::now() < until) {
+		DW1000Sim::advance(1000);
+	}
+	DW1000.attachSentHandler(handleSent);
+	return bulkSent == BULK_FRAMES;
+}
+
+/* dispatch queued events while advancing virtual time until the flag is set, returns false on timeout. */
+boolean processUntil(volatile boolean& flag) {
+	uint64_t until = DW1000Sim::now()+STEP_TIMEOUT;
+	while(!flag && DW1000Sim::now() < until) {
+		DW1000.process();
+		DW1000Sim::advance(1000);
+	}
+	return flag;
+}
+
+/* poll the chip without interrupt line while advancing virtual time until the flag is set. */
+boolean pollUntil(volatile boolean& flag, uint64_t timeout = STEP_TIMEOUT) {
+	uint64_t until = DW1000Sim::now()+timeout;
+	while(!flag && DW1000Sim::now() < until) {
+		DW1000Polled.poll();
+		DW1000Sim::advance(1000);
+	}
+	return flag;
+}
+
+/* run the ranging loop until the anchor put a frame on air and handled its sent event, returns false on timeout. */
+boolean rangingUntilSent() {
+	uint64_t until  = DW1000Sim::now()+STEP_TIMEOUT;
+	uint16_t frames = airFrames;
+	while(airFrames == frames && DW1000Sim::now() < until) {
+		DW1000Ranging.loop();
+		DW1000Sim::advance(1000);
+	}
+	DW1000Ranging.loop();
+	return airFrames != frames;
+}
+
+/* average current of the chip over the time since start(), from the time its receiver was listening [mA]. */
+float averageCurrent(uint8_t ss = PIN_SS) {
+	double duty = (double)DW1000Sim::getReceiveTime(ss)/(DW1000Sim::now()-lastTime);
+	return (float)(duty*RX_CURRENT+(1.0-duty)*IDLE_CURRENT);
+}
+
+/* run the ranging loop for the given virtual time [ns]. */
+void rangingFor(uint64_t duration) {
+	uint64_t until = DW1000Sim::now()+duration;
+	while(DW1000Sim::now() < until) {
+		DW1000Ranging.loop();
+		DW1000Sim::advance(1000);
+	}
+}
+
+/* two frames back to back while the application is busy (deferred interrupts), returns the frames received. */
+uint16_t receiveBurst(boolean doubleBuffered, const byte data[]) {
+	DW1000.newConfiguration();
+	DW1000.setDoubleBuffering(doubleBuffered);
+	DW1000.commitConfiguration();
+	DW1000.useDeferredInterrupts(true);
+	DW1000.newReceive();
+	DW1000.setDefaults();
+	DW1000.receivePermanently(true);
+	DW1000.startReceive();
+	receivedFrames = 0;
+	start();
+	DW1000Sim::injectFrame(data, 20, 3.0f);
+	DW1000Sim::advance(4000000ULL); // air time of the first frame
+	DW1000Sim::injectFrame(data, 20, 3.0f);
+	DW1000Sim::advance(4000000ULL);
+	uint64_t until = DW1000Sim::now()+STEP_TIMEOUT/10;
+	while(DW1000Sim::now() < until) {
+		DW1000.process();
+		DW1000Sim::advance(1000);
+	}
+	DW1000.receivePermanently(false);
+	DW1000.useDeferredInterrupts(false);
+	DW1000.newConfiguration();
+	DW1000.setDoubleBuffering(false);
+	DW1000.commitConfiguration();
+	return receivedFrames;
+}
+
+void configure(DW1000Class& dw = DW1000) {
+	dw.newConfiguration();
+	dw.setDefaults();
+	dw.setDeviceAddress(5);
+	dw.setNetworkId(10);
+	dw.enableMode(dw.MODE_LONGDATA_RANGE_LOWPOWER);
+	dw.commitConfiguration();
+}
+
+int main() {
+	byte data[LEN_DATA];
+	byte rxData[LEN_DATA];
+	char name[64];
+	DW1000Time rxTime;
+
+	DW1000Sim::addChip(PIN_SS, PIN_IRQ, PIN_RST);
+	DW1000Sim::onTransmit(handleTransmit);
+	printf("%-36s %6s %7s %5s %11s %9s\n", "operation", "cs", "bytes", "irqs", "time [us]", "air [us]");
+
+	// bring up and configuration
+	start();
+	DW1000.begin(PIN_IRQ, PIN_RST);
+	DW1000.select(PIN_SS);
+	configure();
+	report("init (begin, select, configure)");
+
+	start();
+	DW1000.newConfiguration();
+	DW1000.commitConfiguration();
+	report("commit unchanged configuration");
+
+	start();
+	configure();
+	report("configure, same settings");
+
+	DW1000.attachSentHandler(handleSent);
+	DW1000.attachReceivedHandler(handleReceived);
+
+	// transmit a full ranging sized frame, until the sent handler ran
+	for(uint16_t i = 0; i < LEN_DATA; i++) {
+		data[i] = (byte)i;
+	}
+	start();
+	sentAck = false;
+	DW1000.newTransmit();
+	DW1000.setDefaults();
+	DW1000.setData(data, LEN_DATA);
+	DW1000.startTransmit();
+	if(!waitFor(sentAck)) {
+		printf("transmit timed out\n");
+		return 1;
+	}
+	report("transmit 90 byte frame");
+
+	// interrupts only, i.e. what handleInterrupt() costs per frame
+	sentAck = false;
+	DW1000.newTransmit();
+	DW1000.setDefaults();
+	DW1000.setData(data, 20);
+	DW1000.startTransmit();
+	start();
+	if(!waitFor(sentAck)) {
+		printf("transmit timed out\n");
+		return 1;
+	}
+	report("irq: frame sent");
+
+	// bulk data at 6.8 Mb/s: send, wait for the sent event, upload the next frame and send, or
+	// stream, i.e. upload the next frame while the current one is on air
+	DW1000.newConfiguration();
+	DW1000.enableMode(DW1000.MODE_SHORTDATA_FAST_ACCURACY);
+	DW1000.commitConfiguration();
+	for(uint8_t streamed = 0; streamed < 2; streamed++) {
+		start();
+		if(!sendBulk(streamed)) {
+			printf("bulk transmit timed out\n");
+			return 1;
+		}
+		snprintf(name, sizeof(name), "%s %ux%u bytes, %.0f kb/s", streamed ? "stream" : "send", BULK_FRAMES, BULK_LEN,
+		         BULK_FRAMES*BULK_LEN*8.0e6/(DW1000Sim::now()-lastTime));
+		report(name);
+	}
+	configure();
+
+	receivedAck = false;
+	DW1000.newReceive();
+	DW1000.setDefaults();
+	DW1000.startReceive();
+	start();
+	DW1000Sim::injectFrame(data, 20, 3.0f);
+	if(!waitFor(receivedAck)) {
+		printf("receive timed out\n");
+		return 1;
+	}
+	report("irq: frame received");
+
+	receivedAck = false;
+	DW1000.newReceive();
+	DW1000.setDefaults();
+	DW1000.receivePermanently(true);
+	DW1000.startReceive();
+	start();
+	DW1000Sim::injectFrame(data, 20, 3.0f);
+	if(!waitFor(receivedAck)) {
+		printf("receive timed out\n");
+		return 1;
+	}
+	report("irq: frame received, permanent rx");
+
+	// a corrupt frame, the receiver has to be on again for the next one
+	failedAck      = false;
+	receivedFrames = 0;
+	DW1000.newConfiguration();
+	DW1000.interruptOnReceiveFailed(true);
+	DW1000.commitConfiguration();
+	DW1000.attachReceiveFailedHandler(handleReceiveFailed);
+	DW1000.newReceive();
+	DW1000.receivePermanently(true);
+	DW1000.startReceive();
+	start();
+	DW1000Sim::injectFrame(data, 20, 3.0f, true);
+	if(!waitFor(failedAck)) {
+		printf("corrupt frame not reported\n");
+		return 1;
+	}
+	report("irq: corrupt frame, permanent rx");
+	DW1000Sim::injectFrame(data, 20, 3.0f);
+	DW1000Sim::advance(STEP_TIMEOUT/10);
+	if(receivedFrames != 1) {
+		printf("frame after a corrupt one lost\n");
+		return 1;
+	}
+	DW1000.receivePermanently(false);
+	DW1000.newConfiguration();
+	DW1000.interruptOnReceiveFailed(false);
+	DW1000.commitConfiguration();
+
+	// receive a frame of another station, until data and timestamp are read
+	start();
+	receivedAck = false;
+	DW1000.newReceive();
+	DW1000.setDefaults();
+	DW1000.startReceive();
+	DW1000Sim::injectFrame(data, 20, 3.0f);
+	if(!waitFor(receivedAck)) {
+		printf("receive timed out\n");
+		return 1;
+	}
+	uint16_t len = DW1000.getDataLength();
+	DW1000.getData(rxData, len);
+	DW1000.getReceiveTimestamp(rxTime);
+	report("receive 20 byte frame");
+	start();
+	float quality = DW1000.getReceivePower()+DW1000.getFirstPathPower()+DW1000.getReceiveQuality();
+	report("receive power and quality");
+	if(isnan(quality)) {
+		printf("receive quality unavailable\n");
+		return 1;
+	}
+	if(len != 20 || memcmp(rxData, data, len) != 0) {
+		printf("received data corrupted (%u bytes)\n", len);
+		return 1;
+	}
+
+	// receive while the application holds the bus, the interrupt is handled on release
+	start();
+	receivedAck = false;
+	DW1000.newReceive();
+	DW1000.setDefaults();
+	DW1000.startReceive();
+	DW1000Class::acquireBus();
+	DW1000Sim::injectFrame(data, 20, 3.0f);
+	DW1000Sim::advance(STEP_TIMEOUT/10);
+	if(receivedAck || DW1000Sim::getInterruptCount(PIN_SS) != 1) {
+		printf("interrupt not deferred while the bus was held\n");
+		return 1;
+	}
+	DW1000Class::releaseBus();
+	if(!receivedAck) {
+		printf("deferred interrupt lost\n");
+		return 1;
+	}
+	report("receive 20 byte frame, bus held");
+
+	// receive with deferred interrupt processing, callbacks run from process()
+	start();
+	receivedAck = false;
+	DW1000.useDeferredInterrupts(true);
+	DW1000.newReceive();
+	DW1000.setDefaults();
+	DW1000.startReceive();
+	DW1000Sim::injectFrame(data, 20, 3.0f);
+	if(!processUntil(receivedAck)) {
+		printf("deferred receive timed out\n");
+		return 1;
+	}
+	DW1000.useDeferredInterrupts(false);
+	report("receive 20 byte frame, deferred");
+
+	// back-to-back frames, e.g. responses to a broadcast, are lost while the receiver waits for a restart
+	uint16_t frames = receiveBurst(false, data);
+	snprintf(name, sizeof(name), "2 frames, single buffer: %u received", frames);
+	report(name);
+	frames = receiveBurst(true, data);
+	snprintf(name, sizeof(name), "2 frames, double buffer: %u received", frames);
+	report(name);
+	if(frames != 2) {
+		printf("double buffered receive lost frames\n");
+		return 1;
+	}
+
+	// the receiver is restarted before process() got to the first frame: each callback still sees the
+	// metadata of its own frame
+	DW1000.useDeferredInterrupts(true);
+	DW1000.attachReceivedHandler(handleDeferredReceived);
+	receivedFrames = 0;
+	start();
+	for(uint8_t i = 0; i < 2; i++) {
+		DW1000.newReceive();
+		DW1000.setDefaults();
+		DW1000.startReceive();
+		DW1000Sim::injectFrame(data, DEFERRED_LEN[i], 3.0f);
+		DW1000Sim::advance(STEP_TIMEOUT/10);
+	}
+	while(DW1000.process() > 0) {
+	}
+	DW1000.useDeferredInterrupts(false);
+	DW1000.attachReceivedHandler(handleReceived);
+	report("2 frames, deferred, one process()");
+	if(receivedFrames != 2 || deferredLength[0] != DEFERRED_LEN[0] || deferredLength[1] != DEFERRED_LEN[1]) {
+		printf("deferred callbacks got the frame lengths %u and %u\n", deferredLength[0], deferredLength[1]);
+		return 1;
+	}
+
+	// two instances on two chips, the second one sends to the default one
+	DW1000Sim::addChip(PIN_SS2, PIN_IRQ2, PIN_RST2);
+	DW1000Sim::setPosition(PIN_SS2, 3.0f, 0.0f, 0.0f);
+	if(!DW1000Second.begin(PIN_IRQ2, PIN_RST2)) {
+		printf("no interrupt slot for the second instance\n");
+		return 1;
+	}
+	DW1000Second.select(PIN_SS2);
+	configure(DW1000Second);
+	DW1000Second.attachSentHandler(handleSent);
+	start();
+	sentAck     = false;
+	receivedAck = false;
+	DW1000.newReceive();
+	DW1000.setDefaults();
+	DW1000.startReceive();
+	DW1000Second.newTransmit();
+	DW1000Second.setDefaults();
+	DW1000Second.setData(data, 20);
+	DW1000Second.startTransmit();
+	if(!waitFor(sentAck) || !waitFor(receivedAck)) {
+		printf("second instance: transfer timed out\n");
+		return 1;
+	}
+	len = DW1000.getDataLength();
+	DW1000.getData(rxData, len);
+	report("two instances: 20 byte frame, tx", PIN_SS2);
+	report("two instances: 20 byte frame, rx");
+	if(len != 20 || memcmp(rxData, data, len) != 0) {
+		printf("second instance: received data corrupted (%u bytes)\n", len);
+		return 1;
+	}
+
+	// frame filtering and auto-acknowledge: a data frame requesting an acknowledgement, then one to another address
+	DW1000.newConfiguration();
+	DW1000.setFrameFilter(true);
+	DW1000.setFrameFilterAllowData(true);
+	DW1000.setAutoAcknowledge(true);
+	DW1000.commitConfiguration();
+	DW1000.setAcknowledgeTime(3);
+	byte dataFrame[20];
+	memset(dataFrame, 0, sizeof(dataFrame));
+	dataFrame[0] = FC_1_DATA_W_ACK;
+	dataFrame[1] = FC_2_SHORT;
+	dataFrame[2] = 0x2A;                 // sequence number
+	dataFrame[3] = 10; dataFrame[4] = 0; // network id
+	dataFrame[5] = 5;  dataFrame[6] = 0; // device address
+	dataFrame[7] = 6;  dataFrame[8] = 0;
+	receivedAck = false;
+	sentAck     = false;
+	DW1000.newReceive();
+	DW1000.setDefaults();
+	DW1000.receivePermanently(true);
+	DW1000.startReceive();
+	start();
+	uint16_t acks = airFrames;
+	DW1000Second.newTransmit();
+	DW1000Second.setDefaults();
+	DW1000Second.setData(dataFrame, sizeof(dataFrame));
+	DW1000Second.startTransmit();
+	if(!waitFor(receivedAck)) {
+		printf("frame filter: data frame not received\n");
+		return 1;
+	}
+	uint64_t until = DW1000Sim::now()+STEP_TIMEOUT;
+	while(airFrames != acks+2 && DW1000Sim::now() < until) {
+		DW1000Sim::advance(1000);
+	}
+	if(airFrames != acks+2 || airFrameLength != 5 || airFrame[0] != 0x02 || airFrame[2] != 0x2A) {
+		printf("frame filter: no acknowledgement sent\n");
+		return 1;
+	}
+	report("auto-ACK: data frame, ACK sent");
+	receivedAck = false;
+	dataFrame[0] = FC_1_DATA_WO_ACK;
+	dataFrame[5] = 7;
+	start();
+	DW1000Sim::injectFrame(dataFrame, sizeof(dataFrame), 3.0f);
+	DW1000Sim::advance(STEP_TIMEOUT/10);
+	report("filter: frame to another address");
+	dataFrame[5] = 5;
+	DW1000Sim::injectFrame(dataFrame, sizeof(dataFrame), 3.0f);
+	if(!waitFor(receivedAck)) {
+		printf("frame filter: receiver off after a rejected frame\n");
+		return 1;
+	}
+	DW1000.receivePermanently(false);
+	DW1000.newConfiguration();
+	DW1000.setFrameFilter(false);
+	DW1000.setAutoAcknowledge(false);
+	DW1000.commitConfiguration();
+
+	// polled operation without interrupt line, compare the latency (time) with the irq rows above
+	DW1000Sim::addChip(PIN_SS3, 0xff, PIN_RST3);
+	DW1000Polled.begin(0xff, PIN_RST3);
+	DW1000Polled.select(PIN_SS3);
+	configure(DW1000Polled);
+	DW1000Polled.attachSentHandler(handleSent);
+	DW1000Polled.attachReceivedHandler(handleReceived);
+	sentAck = false;
+	DW1000Polled.newTransmit();
+	DW1000Polled.setDefaults();
+	DW1000Polled.setData(data, 20);
+	DW1000Polled.startTransmit();
+	start();
+	if(!pollUntil(sentAck)) {
+		printf("polled transmit timed out\n");
+		return 1;
+	}
+	report("polled: frame sent", PIN_SS3);
+
+	receivedAck = false;
+	DW1000Polled.newReceive();
+	DW1000Polled.setDefaults();
+	DW1000Polled.startReceive();
+	start();
+	DW1000Sim::injectFrame(data, 20, 3.0f);
+	if(!pollUntil(receivedAck)) {
+		printf("polled receive timed out\n");
+		return 1;
+	}
+	report("polled: frame received", PIN_SS3);
+
+	// listening for a while lets the poll interval back off, the frame then comes in at any phase of it
+	uint64_t worst = 0;
+	for(uint8_t phase = 0; phase < 10; phase++) {
+		receivedAck = false;
+		DW1000Polled.newReceive();
+		DW1000Polled.setDefaults();
+		DW1000Polled.startReceive();
+		pollUntil(receivedAck, 50000000ULL+phase*1000000ULL);
+		start();
+		DW1000Sim::injectFrame(data, 20, 3.0f);
+		if(!pollUntil(receivedAck)) {
+			printf("polled receive timed out\n");
+			return 1;
+		}
+		if(DW1000Sim::now()-lastTime > worst) {
+			worst = DW1000Sim::now()-lastTime;
+		}
+	}
+	printf("%-36s %6s %7s %5s %11.1f %9s\n", "polled: frame received, idle (worst)", "-", "-", "-", worst/1000.0, "-");
+
+	// ranging protocol as anchor, the tag is played by injected frames
+	DW1000Ranging.initCommunication(PIN_RST, PIN_SS, PIN_IRQ);
+	DW1000Ranging.startAsAnchor((char*)"82:17:5B:D5:A9:9A:E2:9C", DW1000.MODE_LONGDATA_RANGE_ACCURACY, false);
+	byte* anchorShort = DW1000Ranging.getCurrentShortAddress();
+	byte tagAddress[8]    = {0x7D, 0x00, 0x22, 0xEA, 0x82, 0x60, 0x3B, 0x9C};
+	byte tagShort[2]      = {0x7D, 0x00};
+	DW1000Mac tagMac;
+
+	start();
+	tagMac.generateBlinkFrame(data, tagAddress, tagShort);
+	DW1000Sim::injectFrame(data, 12, 5.0f);
+	if(!rangingUntilSent() || DW1000Ranging.detectMessageType(airFrame) != RANGING_INIT) {
+		printf("anchor did not answer BLINK\n");
+		return 1;
+	}
+	report("anchor: BLINK -> RANGING_INIT");
+
+	// ranging rounds of the anchor: POLL -> POLL_ACK, RANGE -> RANGE_REPORT, the second one with the
+	// messages already in the transmit buffer
+	uint16_t replyTime = DEFAULT_REPLY_DELAY_TIME;
+	byte broadcast[2] = {0xFF, 0xFF};
+	byte pollFrame[SHORT_MAC_LEN+6];
+	for(uint8_t r = 0; r < 2; r++) {
+		Totals round = Totals();
+		uint64_t roundStart = DW1000Sim::now();
+		start();
+		tagMac.generateShortMACFrame(data, tagShort, broadcast);
+		data[SHORT_MAC_LEN]   = POLL;
+		data[SHORT_MAC_LEN+1] = 1;
+		memcpy(data+SHORT_MAC_LEN+2, anchorShort, 2);
+		memcpy(data+SHORT_MAC_LEN+4, &replyTime, 2);
+		DW1000Sim::injectFrame(data, SHORT_MAC_LEN+6, 5.0f);
+		if(!rangingUntilSent() || DW1000Ranging.detectMessageType(airFrame) != POLL_ACK) {
+			printf("anchor did not answer POLL\n");
+			return 1;
+		}
+		if(r == 0) {
+			report("anchor: POLL -> POLL_ACK");
+		}
+		addTo(round);
+
+		// the tag answers one reply delay after the POLL_ACK, inside the anchor's receive window
+		memcpy(pollFrame, data, sizeof(pollFrame));
+		rangingFor(replyTime*1000ULL);
+		start();
+		tagMac.generateShortMACFrame(data, tagShort, broadcast);
+		memset(data+SHORT_MAC_LEN, 0, 2+17);
+		data[SHORT_MAC_LEN]   = RANGE;
+		data[SHORT_MAC_LEN+1] = 1;
+		memcpy(data+SHORT_MAC_LEN+2, anchorShort, 2);
+		DW1000Sim::injectFrame(data, SHORT_MAC_LEN+2+17, 5.0f);
+		if(!rangingUntilSent() || DW1000Ranging.detectMessageType(airFrame) != RANGE_REPORT) {
+			printf("anchor did not answer RANGE\n");
+			return 1;
+		}
+		if(r == 0) {
+			report("anchor: RANGE in window -> REPORT");
+		}
+		addTo(round);
+		report(r == 0 ? "anchor: ranging round" : "anchor: ranging round, again", round, DW1000Sim::now()-roundStart);
+		if(r == 1 && round.transactions > RANGING_ROUND_TRANSACTIONS) {
+			printf("ranging round takes %u SPI transactions, %u tracked\n", round.transactions, RANGING_ROUND_TRANSACTIONS);
+			return 1;
+		}
+	}
+
+	// no RANGE follows, the anchor is back to expecting a POLL once the window timed out
+	DW1000Sim::injectFrame(pollFrame, sizeof(pollFrame), 5.0f);
+	if(!rangingUntilSent() || DW1000Ranging.detectMessageType(airFrame) != POLL_ACK) {
+		printf("anchor did not answer POLL\n");
+		return 1;
+	}
+	start();
+	until = DW1000Sim::now()+STEP_TIMEOUT;
+	while(DW1000Ranging._expectedMsgId != POLL && DW1000Sim::now() < until) {
+		DW1000Ranging.loop();
+		DW1000Sim::advance(1000);
+	}
+	if(DW1000Ranging._expectedMsgId != POLL) {
+		printf("anchor receive window did not close\n");
+		return 1;
+	}
+	report("anchor: no RANGE, window closed");
+
+	// a POLL_ACK of another anchor to another tag does not wake the anchor
+	start();
+	byte otherTag[2]    = {0x12, 0x34};
+	byte otherAnchor[2] = {0x56, 0x78};
+	tagMac.generateShortMACFrame(data, otherAnchor, otherTag);
+	data[SHORT_MAC_LEN] = POLL_ACK;
+	DW1000Sim::injectFrame(data, SHORT_MAC_LEN+1, 5.0f);
+	rangingFor(STEP_TIMEOUT/10);
+	report("anchor: frame to another tag");
+
+	// listening while no exchange is going on, continuously and in sniff mode
+	start();
+	rangingFor(1000000000ULL);
+	snprintf(name, sizeof(name), "anchor: idle 1 s, %.0f mA", averageCurrent());
+	report(name);
+	DW1000Ranging.useSniffMode(true);
+	DW1000Ranging.receiver();
+	start();
+	rangingFor(1000000000ULL);
+	snprintf(name, sizeof(name), "anchor: idle 1 s, sniff, %.0f mA", averageCurrent());
+	report(name);
+	start();
+	DW1000Sim::injectFrame(pollFrame, sizeof(pollFrame), 5.0f);
+	if(!rangingUntilSent() || DW1000Ranging.detectMessageType(airFrame) != POLL_ACK) {
+		printf("anchor did not answer POLL in sniff mode\n");
+		return 1;
+	}
+	report("anchor: POLL -> POLL_ACK, sniff");
+
+	// frames of the sketch queued at once, sent one after the other from the ranging loop
+	rangingFor(STEP_TIMEOUT/10);
+	start();
+	tagMac.generateShortMACFrame(data, anchorShort, tagShort);
+	for(uint8_t i = 0; i < QUEUED_FRAMES; i++) {
+		data[SHORT_MAC_LEN] = 0xA0+i;
+		if(!DW1000Ranging.queueFrame(data, 20, handleQueuedDone)) {
+			printf("anchor did not queue frame\n");
+			return 1;
+		}
+	}
+	until = DW1000Sim::now()+STEP_TIMEOUT;
+	while(queuedSent < QUEUED_FRAMES && DW1000Sim::now() < until) {
+		DW1000Ranging.loop();
+		DW1000Sim::advance(1000);
+	}
+	if(queuedSent < QUEUED_FRAMES || airFrame[SHORT_MAC_LEN] != 0xA0+QUEUED_FRAMES-1) {
+		printf("anchor did not send queued frames\n");
+		return 1;
+	}
+	report("anchor: 3 queued frames sent");
+
+	// a reply time shorter than the processing takes: the POLL_ACK is late and sent a bit later
+	rangingFor(STEP_TIMEOUT/10);
+	DW1000Ranging.resetLateness();
+	start();
+	memcpy(data, pollFrame, sizeof(pollFrame));
+	uint16_t shortReply = 1000;
+	memcpy(data+SHORT_MAC_LEN+4, &shortReply, 2);
+	DW1000Sim::injectFrame(data, sizeof(pollFrame), 5.0f);
+	if(!rangingUntilSent() || DW1000Ranging.detectMessageType(airFrame) != POLL_ACK || DW1000Ranging.getLateCount(POLL_ACK) != 1) {
+		printf("anchor did not reschedule late POLL_ACK\n");
+		return 1;
+	}
+	snprintf(name, sizeof(name), "anchor: late POLL_ACK, %ld us left", (long)DW1000Ranging.getMinMargin(POLL_ACK));
+	report(name);
+
+	// ranging protocol as tag with two anchors, played by injected frames: the first one answers the POLL
+	// in its slot, the second one not, so its window closes empty and the RANGE has to follow anyway
+	rangingFor(STEP_TIMEOUT/10);
+	while(DW1000Ranging._networkDevicesNumber > 0) {
+		DW1000Ranging.removeNetworkDevices(0);
+	}
+	DW1000Ranging.useSniffMode(false);
+	DW1000Ranging.startAsTag((char*)"7D:00:22:EA:82:60:3B:9C", DW1000.MODE_LONGDATA_RANGE_ACCURACY, false);
+	byte anchorShorts[2][2] = {{0x82, 0x17}, {0x56, 0x78}};
+	DW1000Mac anchorMac;
+	for(uint8_t i = 0; i < 2; i++) {
+		anchorMac.generateLongMACFrame(data, anchorShorts[i], tagAddress);
+		data[LONG_MAC_LEN] = RANGING_INIT;
+		DW1000Sim::injectFrame(data, LONG_MAC_LEN+1, 5.0f);
+		rangingFor(STEP_TIMEOUT/10);
+	}
+	if(DW1000Ranging._networkDevicesNumber != 2) {
+		printf("tag did not add the anchors\n");
+		return 1;
+	}
+	// the POLL goes out with the next timer tick, maybe after a BLINK
+	boolean polled = false;
+	for(uint8_t i = 0; i < 5 && !polled; i++) {
+		polled = rangingUntilSent() && DW1000Ranging.detectMessageType(airFrame) == POLL;
+	}
+	if(!polled) {
+		printf("tag did not send POLL\n");
+		return 1;
+	}
+	start();
+	uint64_t pollEnd = DW1000Sim::now();
+	rangingFor(DEFAULT_REPLY_DELAY_TIME*1000ULL);
+	anchorMac.generateShortMACFrame(data, anchorShorts[0], tagShort);
+	data[SHORT_MAC_LEN] = POLL_ACK;
+	DW1000Sim::injectFrame(data, SHORT_MAC_LEN+1, 5.0f);
+	until = DW1000Sim::now()+STEP_TIMEOUT;
+	while(!DW1000Ranging._pollAckReceived[0] && DW1000Sim::now() < until) {
+		DW1000Ranging.loop();
+		DW1000Sim::advance(1000);
+	}
+	if(!DW1000Ranging._pollAckReceived[0] || !DW1000Ranging._rxWindow || DW1000Ranging._rxWindowSlots != 1) {
+		printf("tag did not open the window of the second anchor\n");
+		return 1;
+	}
+	report("tag: POLL_ACK, second window open");
+	// the second window closes empty, the RANGE (for the first anchor only) follows its slot
+	start();
+	if(!rangingUntilSent() || DW1000Ranging.detectMessageType(airFrame) != RANGE || airFrame[SHORT_MAC_LEN+1] != 1 ||
+	   memcmp(airFrame+SHORT_MAC_LEN+2, anchorShorts[0], 2) != 0 || DW1000Ranging._expectedMsgId != RANGE_REPORT) {
+		printf("tag did not send RANGE after the empty window\n");
+		return 1;
+	}
+	// into the window of the first anchor, opened a guard time before three reply times after its POLL_ACK
+	DW1000Device* first = &DW1000Ranging._networkDevices[0];
+	double rangeAfterAck = (first->timeRangeSent-first->timePollAckReceived).wrap().getAsMicroSeconds();
+	if(rangeAfterAck < 3.0*DEFAULT_REPLY_DELAY_TIME-DEFAULT_RX_WINDOW_GUARD || rangeAfterAck > 3.0*DEFAULT_REPLY_DELAY_TIME+DEFAULT_RX_WINDOW_GUARD) {
+		printf("tag sent RANGE %.0f us after the POLL_ACK, outside the window of the anchor\n", rangeAfterAck);
+		return 1;
+	}
+	snprintf(name, sizeof(name), "tag: window closed -> RANGE, %.0f ms", (DW1000Sim::now()-pollEnd)/1000000.0);
+	report(name);
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file Arduino.h
+ * Minimal Arduino core for host builds of the library (see DW1000Hal.h).
+ *
+ * Only what the library uses besides the hardware abstraction: types, String,
+ * Print/Printable with a Serial on stdout, random numbers and flash access.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT  0x0
+#define OUTPUT 0x1
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define F(string_literal) (string_literal)
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+
+class String {
+public:
+	String(const char* str = "") : _str(str) {}
+	unsigned int length() const { return _str.length(); }
+	const char* c_str() const { return _str.c_str(); }
+	void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const;
+	void remove(unsigned int index) { if(index < _str.length()) _str.erase(index); }
+	String& operator=(const char* str) { _str = str; return *this; }
+	String& operator+=(char c) { _str += c; return *this; }
+	String& operator+=(const char* str) { _str += str; return *this; }
+	String& operator+=(const String& str) { _str += str._str; return *this; }
+	bool operator==(const char* str) const { return _str == str; }
+private:
+	std::string _str;
+};
+
+class Print;
+
+class Printable {
+public:
+	virtual ~Printable() {}
+	virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	size_t write(const char* str);
+
+	size_t print(const char* str) { return write(str); }
+	size_t print(const String& str) { return write(str.c_str()); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+	size_t print(int n, int base = DEC) { return print((long)n, base); }
+	size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+	size_t print(long n, int base = DEC);
+	size_t print(unsigned long n, int base = DEC);
+	size_t print(double n, int digits = 2);
+	size_t print(const Printable& x) { return x.printTo(*this); }
+
+	size_t println() { return write((uint8_t)'\n'); }
+	template<typename T> size_t println(const T& x) { size_t n = print(x); return n+println(); }
+	template<typename T> size_t println(const T& x, int format) { size_t n = print(x, format); return n+println(); }
+};
+
+class HardwareSerial : public Print {
+public:
+	void begin(unsigned long /* baud */) {}
+	operator bool() { return true; }
+	size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+	using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+int analogRead(uint8_t pin);
+
+#endif
@@ -23,55 +23,113 @@
 DW1000Class DW1000;
 
 /* ###########################################################################
- * #### Static member variables ##############################################
+ * #### Instances #############################################################
  * ######################################################################### */
-// pins
-uint8_t DW1000Class::_ss;
-uint8_t DW1000Class::_rst;
-uint8_t DW1000Class::_irq;
-
-// IRQ callbacks
-void (*DW1000Class::_handleSent)(void) = 0;
-void (*DW1000Class::_handleError)(void) = 0;
-void (*DW1000Class::_handleReceived)(void) = 0;
-void (*DW1000Class::_handleReceiveFailed)(void) = 0;
-void (*DW1000Class::_handleReceiveTimeout)(void) = 0;
-void (*DW1000Class::_handleReceiveTimestampAvailable)(void) = 0;
-
-// registers
-byte DW1000Class::_syscfg[LEN_SYS_CFG];
-byte DW1000Class::_sysctrl[LEN_SYS_CTRL];
-byte DW1000Class::_sysstatus[LEN_SYS_STATUS];
-byte DW1000Class::_txfctrl[LEN_TX_FCTRL];
-byte DW1000Class::_sysmask[LEN_SYS_MASK];
-byte DW1000Class::_chanctrl[LEN_CHAN_CTRL];
-byte DW1000Class::_networkAndAddress[LEN_PANADR];
-byte DW1000Class::_network[LEN_PAN_ID];
-byte DW1000Class::_address[LEN_SHORT_ADDR];
-
-// monitoring
-byte DW1000Class::_vmeas3v3 = 0;
-byte DW1000Class::_tmeas23C = 0;
-
-// driver internal state
-byte DW1000Class::_extendedFrameLength = FRAME_LENGTH_NORMAL;
-byte DW1000Class::_pacSize = PAC_SIZE_8;
-byte DW1000Class::_pulseFrequency = TX_PULSE_FREQ_16MHZ;
-byte DW1000Class::_dataRate = TRX_RATE_6800KBPS;
-byte DW1000Class::_preambleLength = TX_PREAMBLE_LEN_128;
-byte DW1000Class::_preambleCode = PREAMBLE_CODE_16MHZ_4;
-byte DW1000Class::_channel = CHANNEL_5; // CHANNEL_3
-DW1000Time DW1000Class::_antennaDelay;
-boolean DW1000Class::_smartPower = false;
-
-boolean DW1000Class::_frameCheck = true; //true
-boolean DW1000Class::_permanentReceive = false;
-uint8_t DW1000Class::_deviceMode = IDLE_MODE; // TODO replace by enum
-
-int32_t DW1000Class::_antennaDelayValue = 16384;
-int32_t DW1000Class::_manualPowerSetting = 0;
-
-boolean DW1000Class::_debounceClockEnabled = false;
+// instances wired to an interrupt line, one trampoline per slot
+DW1000Class* DW1000Class::_instances[DW1000_MAX_INSTANCES];
+
+void (* const DW1000Class::_isr[DW1000_MAX_INSTANCES])(void) = {
+    isr<0>,
+#if DW1000_MAX_INSTANCES > 1
+    isr<1>,
+#endif
+#if DW1000_MAX_INSTANCES > 2
+    isr<2>,
+#endif
+#if DW1000_MAX_INSTANCES > 3
+    isr<3>,
+#endif
+};
+
+// SPI bus ownership
+volatile uint8_t DW1000Class::_busOwners = 0;
+volatile boolean DW1000Class::_irqPending[DW1000_MAX_INSTANCES];
+
+DW1000Class::DW1000Class()
+{
+    // pins
+    _ss = 0xff;
+    _rst = 0xff;
+    _irq = 0xff;
+    // IRQ callbacks
+    _handleSent = 0;
+    _handleError = 0;
+    _handleReceived = 0;
+    _handleReceiveFailed = 0;
+    _handleReceiveTimeout = 0;
+    _handleReceiveTimestampAvailable = 0;
+    // registers
+    memset(_syscfg, 0, LEN_SYS_CFG);
+    memset(_sysctrl, 0, LEN_SYS_CTRL);
+    memset(_sysstatus, 0, LEN_SYS_STATUS);
+    memset(_txfctrl, 0, LEN_TX_FCTRL);
+    memset(_sysmask, 0, LEN_SYS_MASK);
+    memset(_chanctrl, 0, LEN_CHAN_CTRL);
+    memset(_networkAndAddress, 0, LEN_PANADR);
+    memset(_network, 0, LEN_PAN_ID);
+    memset(_address, 0, LEN_SHORT_ADDR);
+    memset(_pmscctrl0, 0, LEN_PMSC_CTRL0);
+    memset(_pmscctrl1, 0, LEN_PMSC_CTRL1);
+    memset(_pmscledc, 0, LEN_PMSC_LEDC);
+    memset(_gpiomode, 0, LEN_GPIO_MODE);
+    memset(_aonwcfg, 0, LEN_AON_WCFG);
+    memset(_aoncfg0, 0, LEN_AON_CFG0);
+    _shadowValid = 0;
+    _tuneKey = 0;
+    _tuneTxPower = 0;
+    // monitoring
+    _vmeas3v3 = 0;
+    _tmeas23C = 0;
+    _xtalTrim = 0;
+    // driver internal state
+    _extendedFrameLength = FRAME_LENGTH_NORMAL;
+    _pacSize = PAC_SIZE_8;
+    _pulseFrequency = TX_PULSE_FREQ_16MHZ;
+    _dataRate = TRX_RATE_6800KBPS;
+    _preambleLength = TX_PREAMBLE_LEN_128;
+    _preambleCode = PREAMBLE_CODE_16MHZ_4;
+    _channel = CHANNEL_5; // CHANNEL_3
+    _smartPower = false;
+    _frameCheck = true; //true
+    _permanentReceive = false;
+    _deviceMode = IDLE_MODE; // TODO replace by enum
+    _antennaDelayValue = 16384;
+    _manualPowerSetting = 0;
+    _debounceClockEnabled = false;
+    // SPI
+    _currentSPI = &_fastSPI;
+    _csHoldFast = DW1000_CS_HOLD_FAST_US;
+    _csHoldSlow = DW1000_CS_HOLD_SLOW_US;
+    _spiTransactions = 0;
+    _spiBytes = 0;
+    // message timings
+    _rxFrameTime = 0;
+    _txFrameTime = 0;
+    // deferred interrupt processing
+    _deferredInterrupts = false;
+    _eventHead = 0;
+    _eventTail = 0;
+    _droppedEvents = 0;
+    _eventRxStamp = 0;
+    _rxInfoValid = false;
+    // double receive buffer
+    _doubleBuffered = false;
+    _rxBuffersHeld = 0;
+    _rxOverruns = 0;
+    // polled operation
+    _pollMin = DW1000_POLL_MIN_US;
+    _pollMax = DW1000_POLL_MAX_US;
+    _pollInterval = DW1000_POLL_MAX_US;
+    _lastPoll = 0;
+    _txPending = false;
+    _rxPending = false;
+    _ackPending = false;
+    _trxOff = false;
+    _rxStatusClean = false;
+    // streaming transmit
+    _streamHalf = 0;
+    _streamWaiting = 0;
+}
 
 // modes of operation
 // TODO use enum external, not config array
@@ -107,16 +165,11 @@ const byte DW1000Class::BIAS_900_64[] = {147, 133, 117, 99, 75, 50, 29, 0, 24, 4
 // SPI settings
 #ifdef ESP8266
 // default ESP8266 frequency is 80 Mhz, thus divide by 4 is 20 MHz
-const SPISettings DW1000Class::_fastSPI = SPISettings(20000000L, MSBFIRST, SPI_MODE0);
+const DW1000Hal::SpiSettings DW1000Class::_fastSPI = DW1000Hal::spiSettings(20000000L);
 #else
-const SPISettings DW1000Class::_fastSPI = SPISettings(16000000L, MSBFIRST, SPI_MODE0);
+const DW1000Hal::SpiSettings DW1000Class::_fastSPI = DW1000Hal::spiSettings(16000000L);
 #endif
-const SPISettings DW1000Class::_slowSPI = SPISettings(2000000L, MSBFIRST, SPI_MODE0);
-const SPISettings *DW1000Class::_currentSPI = &_fastSPI;
-
-/* Message Timings */
-volatile uint32_t DW1000Class::_rxFrameTime = 0;
-volatile uint32_t DW1000Class::_txFrameTime = 0;
+const DW1000Hal::SpiSettings DW1000Class::_slowSPI = DW1000Hal::spiSettings(2000000L);
 
 /* ###########################################################################
  * #### Init and end #######################################################
@@ -124,7 +177,88 @@ volatile uint32_t DW1000Class::_txFrameTime = 0;
 
 void DW1000Class::end()
 {
-    SPI.end();
+    DW1000Hal::spiEnd();
+}
+
+boolean DW1000Class::poll()
+{
+    if (_irq != 0xff)
+    {
+        return false;
+    }
+    uint32_t now = DW1000Hal::micros();
+    if ((uint32_t)(now - _lastPoll) < _pollInterval)
+    {
+        return false;
+    }
+    _lastPoll = now;
+    acquireBus();
+    readSystemEventStatusRegister();
+    // IRQS mirrors the interrupt line, i.e. whether any of the enabled events is pending
+    if (getBit(_sysstatus, LEN_SYS_STATUS, IRQS_BIT))
+    {
+        handleStatus(now);
+        releaseBus();
+        _rxPending = false;
+        _pollInterval = _pollMin;
+        return true;
+    }
+    if (getBit(_sysstatus, LEN_SYS_STATUS, RXPRD_BIT))
+    {
+        // a frame is coming in, acknowledge its preamble and poll tightly until it completes
+        byte ack[LEN_SYS_STATUS];
+        memset(ack, 0, LEN_SYS_STATUS);
+        setBit(ack, LEN_SYS_STATUS, RXPRD_BIT, true);
+        writeBytes(SYS_STATUS, NO_SUB, ack, LEN_SYS_STATUS);
+        releaseBus();
+        _rxPending = true;
+        _pollInterval = _pollMin;
+        return false;
+    }
+    releaseBus();
+    if (_rxPending && (getBit(_sysstatus, LEN_SYS_STATUS, RXPHE_BIT) || getBit(_sysstatus, LEN_SYS_STATUS, RXFCE_BIT) ||
+                       getBit(_sysstatus, LEN_SYS_STATUS, RXRFSL_BIT) || getBit(_sysstatus, LEN_SYS_STATUS, LDEERR_BIT) ||
+                       getBit(_sysstatus, LEN_SYS_STATUS, RXSFDTO_BIT)))
+    {
+        // the frame failed without an enabled event
+        _rxPending = false;
+    }
+    // back off while nothing is expected, a started transmission or reception completes soon in any case
+    if (!_txPending && !_rxPending && _pollInterval < _pollMax)
+    {
+        uint32_t next = (_pollInterval > 0 ? (uint32_t)_pollInterval * 2 : 1);
+        _pollInterval = (next < _pollMax ? next : _pollMax);
+    }
+    return false;
+}
+
+void DW1000Class::setPollInterval(uint16_t minUs, uint16_t maxUs)
+{
+    _pollMin = minUs;
+    _pollMax = (maxUs < minUs ? minUs : maxUs);
+    _pollInterval = _pollMin;
+}
+
+void DW1000Class::setChipSelectHoldTime(uint8_t fastSpiUs, uint8_t slowSpiUs)
+{
+    _csHoldFast = fastSpiUs;
+    _csHoldSlow = slowSpiUs;
+}
+
+uint32_t DW1000Class::getSpiTransactionCount()
+{
+    return _spiTransactions;
+}
+
+uint32_t DW1000Class::getSpiByteCount()
+{
+    return _spiBytes;
+}
+
+void DW1000Class::resetSpiStats()
+{
+    _spiTransactions = 0;
+    _spiBytes = 0;
 }
 
 void DW1000Class::select(uint8_t ss)
@@ -133,12 +267,12 @@ void DW1000Class::select(uint8_t ss)
     // try locking clock at PLL speed (should be done already,
     // but just to be sure)
     enableClock(AUTO_CLOCK);
-    delay(5);
+    DW1000Hal::delay(5);
     // reset chip (either soft or hard)
     if (_rst != 0xff)
     {
         // dw1000 data sheet v2.08 §5.6.1 page 20, the RSTn pin should not be driven high but left floating.
-        pinMode(_rst, INPUT);
+        DW1000Hal::pinMode(_rst, INPUT);
     }
     reset();
     // default network and node id
@@ -154,11 +288,11 @@ void DW1000Class::select(uint8_t ss)
     writeSystemEventMaskRegister();
     // load LDE micro-code
     enableClock(XTI_CLOCK);
-    delay(5);
+    DW1000Hal::delay(5);
     manageLDE();
-    delay(5);
+    DW1000Hal::delay(5);
     enableClock(AUTO_CLOCK);
-    delay(5);
+    DW1000Hal::delay(5);
 
     // read the temp and vbat readings from OTP that were recorded during production test
     // see 6.3.1 OTP memory map
@@ -167,34 +301,56 @@ void DW1000Class::select(uint8_t ss)
     _vmeas3v3 = buf_otp[0];
     readBytesOTP(0x009, buf_otp); // the stored 23C reading
     _tmeas23C = buf_otp[0];
+    readBytesOTP(0x01E, buf_otp); // the crystal trim value (0 if not calibrated)
+    _xtalTrim = buf_otp[0];
 }
 
 void DW1000Class::reselect(uint8_t ss)
 {
     _ss = ss;
-    pinMode(_ss, OUTPUT);
-    digitalWrite(_ss, HIGH);
+    DW1000Hal::pinMode(_ss, OUTPUT);
+    DW1000Hal::digitalWrite(_ss, HIGH);
 }
 
-void DW1000Class::begin(uint8_t irq, uint8_t rst)
+boolean DW1000Class::begin(uint8_t irq, uint8_t rst)
 {
     // generous initial init/wake-up-idle delay
-    delay(5);
+    DW1000Hal::delay(5);
     // Configure the IRQ pin as INPUT. Required for correct interrupt setting for ESP8266
-    pinMode(irq, INPUT);
+    if (irq != 0xff)
+    {
+        DW1000Hal::pinMode(irq, INPUT);
+    }
     // start SPI
-    SPI.begin();
-#ifndef ESP8266
-    SPI.usingInterrupt(digitalPinToInterrupt(irq)); // not every board support this, e.g. ESP8266
-#endif
+    DW1000Hal::spiBegin(irq);
     // pin and basic member setup
     _rst = rst;
     _irq = irq;
     _deviceMode = IDLE_MODE;
-    // attach interrupt
-    //attachInterrupt(_irq, DW1000Class::handleInterrupt, CHANGE); // todo interrupt for ESP8266
-    // TODO throw error if pin is not a interrupt pin
-    attachInterrupt(digitalPinToInterrupt(_irq), DW1000Class::handleInterrupt, RISING); // todo interrupt for ESP8266
+    if (_irq == 0xff)
+    {
+        // polled operation, see poll()
+        return true;
+    }
+    // attach interrupt, through the trampoline of a free instance slot
+    for (uint8_t slot = 0; slot < DW1000_MAX_INSTANCES; slot++)
+    {
+        if (_instances[slot] == 0 || _instances[slot] == this)
+        {
+            // set before, the interrupt may come in right away
+            _instances[slot] = this;
+            //attachInterrupt(_irq, _isr[slot], CHANGE); // todo interrupt for ESP8266
+            if (!DW1000Hal::attachInterrupt(_irq, _isr[slot])) // todo interrupt for ESP8266
+            {
+                _instances[slot] = 0;
+                break;
+            }
+            return true;
+        }
+    }
+    // all slots taken or no interrupt on the line, the chip is still serviced by poll()
+    _irq = 0xff;
+    return false;
 }
 
 void DW1000Class::manageLDE()
@@ -208,110 +364,94 @@ void DW1000Class::manageLDE()
     }
     // tell the chip to load the LDE microcode
     // TODO remove clock-related code (PMSC_CTRL) as handled separately
-    byte pmscctrl0[LEN_PMSC_CTRL0];
     byte otpctrl[LEN_OTP_CTRL];
-    memset(pmscctrl0, 0, LEN_PMSC_CTRL0);
     memset(otpctrl, 0, LEN_OTP_CTRL);
-    readBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, LEN_PMSC_CTRL0);
+    fetchShadow(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, LEN_PMSC_CTRL0, SHADOW_PMSC_CTRL0);
     readBytes(OTP_IF, OTP_CTRL_SUB, otpctrl, LEN_OTP_CTRL);
-    pmscctrl0[0] = 0x01;
-    pmscctrl0[1] = 0x03;
+    _pmscctrl0[0] = 0x01;
+    _pmscctrl0[1] = 0x03;
     otpctrl[0] = 0x00;
     otpctrl[1] = 0x80;
-    writeBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, 2);
+    writeBytes(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, 2);
     writeBytes(OTP_IF, OTP_CTRL_SUB, otpctrl, 2);
-    delay(5);
-    pmscctrl0[0] = 0x00;
-    pmscctrl0[1] &= 0x02;
-    writeBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, 2);
+    DW1000Hal::delay(5);
+    _pmscctrl0[0] = 0x00;
+    _pmscctrl0[1] &= 0x02;
+    writeBytes(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, 2);
 }
 
 void DW1000Class::enableClock(byte clock)
 {
-    byte pmscctrl0[LEN_PMSC_CTRL0];
-    memset(pmscctrl0, 0, LEN_PMSC_CTRL0);
-    readBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, LEN_PMSC_CTRL0);
+    fetchShadow(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, LEN_PMSC_CTRL0, SHADOW_PMSC_CTRL0);
     switch (clock)
     {
     case AUTO_CLOCK:
         _currentSPI = &_fastSPI;
-        pmscctrl0[0] = AUTO_CLOCK;
-        pmscctrl0[1] &= 0xFE;
+        _pmscctrl0[0] = AUTO_CLOCK;
+        _pmscctrl0[1] &= 0xFE;
         break;
     case XTI_CLOCK:
         _currentSPI = &_slowSPI;
-        pmscctrl0[0] &= 0xFC;
-        pmscctrl0[0] |= XTI_CLOCK;
+        _pmscctrl0[0] &= 0xFC;
+        _pmscctrl0[0] |= XTI_CLOCK;
         break;
     case PLL_CLOCK:
         _currentSPI = &_fastSPI;
-        pmscctrl0[0] &= 0xFC;
-        pmscctrl0[0] |= PLL_CLOCK;
+        _pmscctrl0[0] &= 0xFC;
+        _pmscctrl0[0] |= PLL_CLOCK;
         break;
     }
-    writeBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, 2);
+    writeBytes(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, 2);
 }
 
 void DW1000Class::enableDebounceClock()
 {
-    byte pmscctrl0[LEN_PMSC_CTRL0];
-    memset(pmscctrl0, 0, LEN_PMSC_CTRL0);
-    readBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, LEN_PMSC_CTRL0);
-    setBit(pmscctrl0, LEN_PMSC_CTRL0, GPDCE_BIT, 1);
-    setBit(pmscctrl0, LEN_PMSC_CTRL0, KHZCLKEN_BIT, 1);
-    writeBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, LEN_PMSC_CTRL0);
+    fetchShadow(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, LEN_PMSC_CTRL0, SHADOW_PMSC_CTRL0);
+    setBit(_pmscctrl0, LEN_PMSC_CTRL0, GPDCE_BIT, 1);
+    setBit(_pmscctrl0, LEN_PMSC_CTRL0, KHZCLKEN_BIT, 1);
+    writeBytes(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, LEN_PMSC_CTRL0);
     _debounceClockEnabled = true;
 }
 
 void DW1000Class::enableLedBlinking()
 {
-    byte pmscledc[LEN_PMSC_LEDC];
-    memset(pmscledc, 0, LEN_PMSC_LEDC);
-    readBytes(PMSC, PMSC_LEDC_SUB, pmscledc, LEN_PMSC_LEDC);
-    setBit(pmscledc, LEN_PMSC_LEDC, BLNKEN, 1);
-    writeBytes(PMSC, PMSC_LEDC_SUB, pmscledc, LEN_PMSC_LEDC);
+    fetchShadow(PMSC, PMSC_LEDC_SUB, _pmscledc, LEN_PMSC_LEDC, SHADOW_PMSC_LEDC);
+    setBit(_pmscledc, LEN_PMSC_LEDC, BLNKEN, 1);
+    writeBytes(PMSC, PMSC_LEDC_SUB, _pmscledc, LEN_PMSC_LEDC);
 }
 
 void DW1000Class::setGPIOMode(uint8_t msgp, uint8_t mode)
 {
-    byte gpiomode[LEN_GPIO_MODE];
-    memset(gpiomode, 0, LEN_GPIO_MODE);
-    readBytes(GPIO_CTRL, GPIO_MODE_SUB, gpiomode, LEN_GPIO_MODE);
+    fetchShadow(GPIO_CTRL, GPIO_MODE_SUB, _gpiomode, LEN_GPIO_MODE, SHADOW_GPIO_MODE);
     for (char i = 0; i < 2; i++)
     {
-        setBit(gpiomode, LEN_GPIO_MODE, msgp + i, (mode >> i) & 1);
+        setBit(_gpiomode, LEN_GPIO_MODE, msgp + i, (mode >> i) & 1);
     }
-    writeBytes(GPIO_CTRL, GPIO_MODE_SUB, gpiomode, LEN_GPIO_MODE);
+    writeBytes(GPIO_CTRL, GPIO_MODE_SUB, _gpiomode, LEN_GPIO_MODE);
 }
 
 void DW1000Class::deepSleep()
 {
-    byte aon_wcfg[LEN_AON_WCFG];
-    memset(aon_wcfg, 0, LEN_AON_WCFG);
-    readBytes(AON, AON_WCFG_SUB, aon_wcfg, LEN_AON_WCFG);
-    setBit(aon_wcfg, LEN_AON_WCFG, ONW_LDC_BIT, true);
-    setBit(aon_wcfg, LEN_AON_WCFG, ONW_LDD0_BIT, true);
-    writeBytes(AON, AON_WCFG_SUB, aon_wcfg, LEN_AON_WCFG);
-
-    byte pmsc_ctrl1[LEN_PMSC_CTRL1];
-    memset(pmsc_ctrl1, 0, LEN_PMSC_CTRL1);
-    readBytes(PMSC, PMSC_CTRL1_SUB, pmsc_ctrl1, LEN_PMSC_CTRL1);
-    setBit(pmsc_ctrl1, LEN_PMSC_CTRL1, ATXSLP_BIT, false);
-    setBit(pmsc_ctrl1, LEN_PMSC_CTRL1, ARXSLP_BIT, false);
-    writeBytes(PMSC, PMSC_CTRL1_SUB, pmsc_ctrl1, LEN_PMSC_CTRL1);
-
-    byte aon_cfg0[LEN_AON_CFG0];
-    memset(aon_cfg0, 0, LEN_AON_CFG0);
-    readBytes(AON, AON_CFG0_SUB, aon_cfg0, LEN_AON_CFG0);
-    setBit(aon_cfg0, LEN_AON_CFG0, WAKE_SPI_BIT, true);
-    setBit(aon_cfg0, LEN_AON_CFG0, WAKE_PIN_BIT, true);
-    setBit(aon_cfg0, LEN_AON_CFG0, WAKE_CNT_BIT, false);
-    setBit(aon_cfg0, LEN_AON_CFG0, SLEEP_EN_BIT, true);
-    writeBytes(AON, AON_CFG0_SUB, aon_cfg0, LEN_AON_CFG0);
+    fetchShadow(AON, AON_WCFG_SUB, _aonwcfg, LEN_AON_WCFG, SHADOW_AON_WCFG);
+    setBit(_aonwcfg, LEN_AON_WCFG, ONW_LDC_BIT, true);
+    setBit(_aonwcfg, LEN_AON_WCFG, ONW_LDD0_BIT, true);
+    writeBytes(AON, AON_WCFG_SUB, _aonwcfg, LEN_AON_WCFG);
+
+    fetchShadow(PMSC, PMSC_CTRL1_SUB, _pmscctrl1, LEN_PMSC_CTRL1, SHADOW_PMSC_CTRL1);
+    setBit(_pmscctrl1, LEN_PMSC_CTRL1, ATXSLP_BIT, false);
+    setBit(_pmscctrl1, LEN_PMSC_CTRL1, ARXSLP_BIT, false);
+    writeBytes(PMSC, PMSC_CTRL1_SUB, _pmscctrl1, LEN_PMSC_CTRL1);
+
+    fetchShadow(AON, AON_CFG0_SUB, _aoncfg0, LEN_AON_CFG0, SHADOW_AON_CFG0);
+    setBit(_aoncfg0, LEN_AON_CFG0, WAKE_SPI_BIT, true);
+    setBit(_aoncfg0, LEN_AON_CFG0, WAKE_PIN_BIT, true);
+    setBit(_aoncfg0, LEN_AON_CFG0, WAKE_CNT_BIT, false);
+    setBit(_aoncfg0, LEN_AON_CFG0, SLEEP_EN_BIT, true);
+    writeBytes(AON, AON_CFG0_SUB, _aoncfg0, LEN_AON_CFG0);
 
+    // AON_CTRL bits are commands (self-clearing), so nothing to read back
     byte aon_ctrl[LEN_AON_CTRL];
     memset(aon_ctrl, 0, LEN_AON_CTRL);
-    readBytes(AON, AON_CTRL_SUB, aon_ctrl, LEN_AON_CTRL);
     setBit(aon_ctrl, LEN_AON_CTRL, UPL_CFG_BIT, true);
     setBit(aon_ctrl, LEN_AON_CTRL, SAVE_BIT, true);
     writeBytes(AON, AON_CTRL_SUB, aon_ctrl, LEN_AON_CTRL);
@@ -319,10 +459,15 @@ void DW1000Class::deepSleep()
 
 void DW1000Class::spiWakeup()
 {
-    digitalWrite(_ss, LOW);
-    delay(2);
-    digitalWrite(_ss, HIGH);
-    delay(1);
+    // configuration restored from AON is not necessarily what the driver wrote,
+    // only the always-on registers themselves are kept for sure
+    invalidateShadow(SHADOW_ALL & ~(SHADOW_AON_WCFG | SHADOW_AON_CFG0));
+    _trxOff = false;
+    _rxStatusClean = false;
+    DW1000Hal::digitalWrite(_ss, LOW);
+    DW1000Hal::delay(2);
+    DW1000Hal::digitalWrite(_ss, HIGH);
+    DW1000Hal::delay(1);
     if (_debounceClockEnabled)
     {
         DW1000Class::enableDebounceClock();
@@ -331,6 +476,8 @@ void DW1000Class::spiWakeup()
 
 void DW1000Class::reset()
 {
+    // chip configuration falls back to its defaults
+    invalidateShadow(SHADOW_ALL);
     if (_rst == 0xff)
     {
         softReset();
@@ -338,11 +485,11 @@ void DW1000Class::reset()
     else
     {
         // dw1000 data sheet v2.08 §5.6.1 page 20, the RSTn pin should not be driven high but left floating.
-        pinMode(_rst, OUTPUT);
-        digitalWrite(_rst, LOW);
-        delay(2); // dw1000 data sheet v2.08 §5.6.1 page 20: nominal 50ns, to be safe take more time
-        pinMode(_rst, INPUT);
-        delay(10); // dwm1000 data sheet v1.2 page 5: nominal 3 ms, to be safe take more time
+        DW1000Hal::pinMode(_rst, OUTPUT);
+        DW1000Hal::digitalWrite(_rst, LOW);
+        DW1000Hal::delay(2); // dw1000 data sheet v2.08 §5.6.1 page 20: nominal 50ns, to be safe take more time
+        DW1000Hal::pinMode(_rst, INPUT);
+        DW1000Hal::delay(10); // dwm1000 data sheet v1.2 page 5: nominal 3 ms, to be safe take more time
         // force into idle mode (although it should be already after reset)
         idle();
     }
@@ -350,16 +497,17 @@ void DW1000Class::reset()
 
 void DW1000Class::softReset()
 {
-    byte pmscctrl0[LEN_PMSC_CTRL0];
-    readBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, LEN_PMSC_CTRL0);
-    pmscctrl0[0] = 0x01;
-    writeBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, LEN_PMSC_CTRL0);
-    pmscctrl0[3] = 0x00;
-    writeBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, LEN_PMSC_CTRL0);
-    delay(10);
-    pmscctrl0[0] = 0x00;
-    pmscctrl0[3] = 0xF0;
-    writeBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, LEN_PMSC_CTRL0);
+    // all registers but PMSC_CTRL0 (as written below) fall back to their defaults
+    invalidateShadow(SHADOW_ALL);
+    fetchShadow(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, LEN_PMSC_CTRL0, SHADOW_PMSC_CTRL0);
+    _pmscctrl0[0] = 0x01;
+    writeBytes(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, LEN_PMSC_CTRL0);
+    _pmscctrl0[3] = 0x00;
+    writeBytes(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, LEN_PMSC_CTRL0);
+    DW1000Hal::delay(10);
+    _pmscctrl0[0] = 0x00;
+    _pmscctrl0[3] = 0xF0;
+    writeBytes(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, LEN_PMSC_CTRL0);
     // force into idle mode
     idle();
 }
@@ -382,627 +530,284 @@ void DW1000Class::enableMode(const byte mode[])
     }
 }
 
+/*
+ * Tuning tables (user manual §2.5.5 and §7.2), kept in flash. They are indexed by
+ * - PRF: 0 = 16 MHz, 1 = 64 MHz
+ * - data rate: 0 = 110 kb/s, 1 = 850 kb/s, 2 = 6.8 Mb/s
+ * - PAC size: 0 = 8, 1 = 16, 2 = 32, 3 = 64
+ * - channel: 0..5 = channel 1, 2, 3, 4, 5, 7
+ * - preamble code (1..20, 0 = invalid code)
+ */
+static constexpr uint16_t TUNE_AGC_TUNE1[2] PROGMEM = {0x8870, 0x889B};
+// DRX_TUNE0b (already optimized according to Table 20 of user manual)
+static constexpr uint16_t TUNE_DRX_TUNE0b[3] PROGMEM = {0x0016, 0x0006, 0x0001};
+static constexpr uint16_t TUNE_DRX_TUNE1a[2] PROGMEM = {0x0087, 0x008D};
+static constexpr uint32_t TUNE_DRX_TUNE2[4][2] PROGMEM = {
+    {0x311A002DL, 0x313B006BL},
+    {0x331A0052L, 0x333B00BEL},
+    {0x351A009AL, 0x353B015EL},
+    {0x371A011DL, 0x373B0296L}};
+static constexpr uint16_t TUNE_LDE_CFG2[2] PROGMEM = {0x1607, 0x0607};
+static constexpr uint16_t TUNE_LDE_REPC[21] PROGMEM = {
+    0x0000, 0x5998, 0x5998, 0x51EA, 0x428E, 0x451E, 0x2E14, 0x8000, 0x51EA, 0x28F4, 0x3332,
+    0x3AE0, 0x3D70, 0x0000, 0x0000, 0x0000, 0x0000, 0x3332, 0x35C2, 0x35C2, 0x47AE};
+static constexpr byte TUNE_RF_RXCTRLH[6] PROGMEM = {0xD8, 0xD8, 0xD8, 0xBC, 0xD8, 0xBC};
+static constexpr uint32_t TUNE_RF_TXCTRL[6] PROGMEM = {
+    0x00005C40L, 0x00045CA0L, 0x00086CC0L, 0x00045C80L, 0x001E3FE0L, 0x001E7DE0L};
+static constexpr byte TUNE_TC_PGDELAY[6] PROGMEM = {0xC9, 0xC2, 0xC5, 0x95, 0xC0, 0x93};
+static constexpr uint32_t TUNE_FS_PLLCFG[6] PROGMEM = {
+    0x09000407L, 0x08400508L, 0x08401009L, 0x08400508L, 0x0800041DL, 0x0800041DL};
+static constexpr byte TUNE_FS_PLLTUNE[6] PROGMEM = {0x1E, 0x26, 0x56, 0x26, 0xBE, 0xBE};
+// TX_POWER by channel, PRF and smart transmit power control (off, on)
+static constexpr uint32_t TUNE_TX_POWER[6][2][2] PROGMEM = {
+    {{0x75757575L, 0x15355575L}, {0x67676767L, 0x07274767L}},
+    {{0x75757575L, 0x15355575L}, {0x67676767L, 0x07274767L}},
+    {{0x6F6F6F6FL, 0x0F2F4F6FL}, {0x8B8B8B8BL, 0x2B4B6B8BL}},
+    {{0x5F5F5F5FL, 0x1F1F3F5FL}, {0x9A9A9A9AL, 0x3A5A7A9AL}},
+    {{0x48484848L, 0x0E082848L}, {0x85858585L, 0x25456585L}},
+    {{0x92929292L, 0x32527292L}, {0xD1D1D1D1L, 0x5171B1D1L}}};
+// USR_SFD length (for the non-standard SFD sequences selected in setDataRate())
+static constexpr byte TUNE_SFD_LENGTH[3] PROGMEM = {0x40, 0x10, 0x08};
+
 void DW1000Class::tune()
 {
-    // these registers are going to be tuned/configured
-    byte agctune1[LEN_AGC_TUNE1];
-    byte agctune2[LEN_AGC_TUNE2];
-    byte agctune3[LEN_AGC_TUNE3];
-    byte drxtune0b[LEN_DRX_TUNE0b];
-    byte drxtune1a[LEN_DRX_TUNE1a];
-    byte drxtune1b[LEN_DRX_TUNE1b];
-    byte drxtune2[LEN_DRX_TUNE2];
-    byte drxtune4H[LEN_DRX_TUNE4H];
-    byte ldecfg1[LEN_LDE_CFG1];
-    byte ldecfg2[LEN_LDE_CFG2];
-    byte lderepc[LEN_LDE_REPC];
-    byte txpower[LEN_TX_POWER];
-    byte rfrxctrlh[LEN_RF_RXCTRLH];
-    byte rftxctrl[LEN_RF_TXCTRL];
-    byte tcpgdelay[LEN_TC_PGDELAY];
-    byte fspllcfg[LEN_FS_PLLCFG];
-    byte fsplltune[LEN_FS_PLLTUNE];
-    byte fsxtalt[LEN_FS_XTALT];
-    // AGC_TUNE1
-    if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-    {
-        writeValueToBytes(agctune1, 0x8870, LEN_AGC_TUNE1);
-    }
-    else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-    {
-        writeValueToBytes(agctune1, 0x889B, LEN_AGC_TUNE1);
-    }
-    else
-    {
-        // TODO proper error/warning handling
-    }
-    // AGC_TUNE2
-    writeValueToBytes(agctune2, 0x2502A907L, LEN_AGC_TUNE2);
-    // AGC_TUNE3
-    writeValueToBytes(agctune3, 0x0035, LEN_AGC_TUNE3);
-    // DRX_TUNE0b (already optimized according to Table 20 of user manual)
-    if (_dataRate == TRX_RATE_110KBPS)
-    {
-        writeValueToBytes(drxtune0b, 0x0016, LEN_DRX_TUNE0b);
-    }
-    else if (_dataRate == TRX_RATE_850KBPS)
-    {
-        writeValueToBytes(drxtune0b, 0x0006, LEN_DRX_TUNE0b);
-    }
-    else if (_dataRate == TRX_RATE_6800KBPS)
-    {
-        writeValueToBytes(drxtune0b, 0x0001, LEN_DRX_TUNE0b);
-    }
-    else
-    {
-        // TODO proper error/warning handling
-    }
-    // DRX_TUNE1a
-    if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-    {
-        writeValueToBytes(drxtune1a, 0x0087, LEN_DRX_TUNE1a);
-    }
-    else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-    {
-        writeValueToBytes(drxtune1a, 0x008D, LEN_DRX_TUNE1a);
-    }
-    else
-    {
-        // TODO proper error/warning handling
-    }
-    // DRX_TUNE1b
-    if (_preambleLength == TX_PREAMBLE_LEN_1536 || _preambleLength == TX_PREAMBLE_LEN_2048 ||
-        _preambleLength == TX_PREAMBLE_LEN_4096)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(drxtune1b, 0x0064, LEN_DRX_TUNE1b);
-        }
-        else
-        {
-            // TODO proper error/warning handling
-        }
-    }
-    else if (_preambleLength != TX_PREAMBLE_LEN_64)
-    {
-        if (_dataRate == TRX_RATE_850KBPS || _dataRate == TRX_RATE_6800KBPS)
-        {
-            writeValueToBytes(drxtune1b, 0x0020, LEN_DRX_TUNE1b);
-        }
-        else
-        {
-            // TODO proper error/warning handling
-        }
-    }
-    else
+    // table indices
+    byte prf  = _pulseFrequency - TX_PULSE_FREQ_16MHZ;
+    byte rate = _dataRate;
+    byte pac  = (_pacSize == PAC_SIZE_8 ? 0 : _pacSize == PAC_SIZE_16 ? 1 : _pacSize == PAC_SIZE_32 ? 2 : 3);
+    byte ch   = 0xFF;
+    if (_channel >= CHANNEL_1 && _channel <= CHANNEL_5)
     {
-        if (_dataRate == TRX_RATE_6800KBPS)
-        {
-            writeValueToBytes(drxtune1b, 0x0010, LEN_DRX_TUNE1b);
-        }
-        else
-        {
-            // TODO proper error/warning handling
-        }
-    }
-    // DRX_TUNE2
-    if (_pacSize == PAC_SIZE_8)
-    {
-        if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-        {
-            writeValueToBytes(drxtune2, 0x311A002DL, LEN_DRX_TUNE2);
-        }
-        else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-        {
-            writeValueToBytes(drxtune2, 0x313B006BL, LEN_DRX_TUNE2);
-        }
-        else
-        {
-            // TODO proper error/warning handling
-        }
-    }
-    else if (_pacSize == PAC_SIZE_16)
-    {
-        if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-        {
-            writeValueToBytes(drxtune2, 0x331A0052L, LEN_DRX_TUNE2);
-        }
-        else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-        {
-            writeValueToBytes(drxtune2, 0x333B00BEL, LEN_DRX_TUNE2);
-        }
-        else
-        {
-            // TODO proper error/warning handling
-        }
-    }
-    else if (_pacSize == PAC_SIZE_32)
-    {
-        if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-        {
-            writeValueToBytes(drxtune2, 0x351A009AL, LEN_DRX_TUNE2);
-        }
-        else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-        {
-            writeValueToBytes(drxtune2, 0x353B015EL, LEN_DRX_TUNE2);
-        }
-        else
-        {
-            // TODO proper error/warning handling
-        }
-    }
-    else if (_pacSize == PAC_SIZE_64)
-    {
-        if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-        {
-            writeValueToBytes(drxtune2, 0x371A011DL, LEN_DRX_TUNE2);
-        }
-        else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-        {
-            writeValueToBytes(drxtune2, 0x373B0296L, LEN_DRX_TUNE2);
-        }
-        else
-        {
-            // TODO proper error/warning handling
-        }
-    }
-    else
-    {
-        // TODO proper error/warning handling
-    }
-    // DRX_TUNE4H
-    if (_preambleLength == TX_PREAMBLE_LEN_64)
-    {
-        writeValueToBytes(drxtune4H, 0x0010, LEN_DRX_TUNE4H);
-    }
-    else
-    {
-        writeValueToBytes(drxtune4H, 0x0028, LEN_DRX_TUNE4H);
-    }
-    // RF_RXCTRLH
-    if (_channel != CHANNEL_4 && _channel != CHANNEL_7)
-    {
-        writeValueToBytes(rfrxctrlh, 0xD8, LEN_RF_RXCTRLH);
-    }
-    else
-    {
-        writeValueToBytes(rfrxctrlh, 0xBC, LEN_RF_RXCTRLH);
-    }
-    // RX_TXCTRL
-    if (_channel == CHANNEL_1)
-    {
-        writeValueToBytes(rftxctrl, 0x00005C40L, LEN_RF_TXCTRL);
-    }
-    else if (_channel == CHANNEL_2)
-    {
-        writeValueToBytes(rftxctrl, 0x00045CA0L, LEN_RF_TXCTRL);
-    }
-    else if (_channel == CHANNEL_3)
-    {
-        writeValueToBytes(rftxctrl, 0x00086CC0L, LEN_RF_TXCTRL);
-    }
-    else if (_channel == CHANNEL_4)
-    {
-        writeValueToBytes(rftxctrl, 0x00045C80L, LEN_RF_TXCTRL);
-    }
-    else if (_channel == CHANNEL_5)
-    {
-        writeValueToBytes(rftxctrl, 0x001E3FE0L, LEN_RF_TXCTRL);
-    }
-    else if (_channel == CHANNEL_7)
-    {
-        writeValueToBytes(rftxctrl, 0x001E7DE0L, LEN_RF_TXCTRL);
-    }
-    else
-    {
-        // TODO proper error/warning handling
-    }
-    // TC_PGDELAY
-    if (_channel == CHANNEL_1)
-    {
-        writeValueToBytes(tcpgdelay, 0xC9, LEN_TC_PGDELAY);
-    }
-    else if (_channel == CHANNEL_2)
-    {
-        writeValueToBytes(tcpgdelay, 0xC2, LEN_TC_PGDELAY);
-    }
-    else if (_channel == CHANNEL_3)
-    {
-        writeValueToBytes(tcpgdelay, 0xC5, LEN_TC_PGDELAY);
-    }
-    else if (_channel == CHANNEL_4)
-    {
-        writeValueToBytes(tcpgdelay, 0x95, LEN_TC_PGDELAY);
-    }
-    else if (_channel == CHANNEL_5)
-    {
-        writeValueToBytes(tcpgdelay, 0xC0, LEN_TC_PGDELAY);
+        ch = _channel - CHANNEL_1;
     }
     else if (_channel == CHANNEL_7)
     {
-        writeValueToBytes(tcpgdelay, 0x93, LEN_TC_PGDELAY);
-    }
-    else
-    {
-        // TODO proper error/warning handling
-    }
-    // FS_PLLCFG and FS_PLLTUNE
-    if (_channel == CHANNEL_1)
-    {
-        writeValueToBytes(fspllcfg, 0x09000407L, LEN_FS_PLLCFG);
-        writeValueToBytes(fsplltune, 0x1E, LEN_FS_PLLTUNE);
-    }
-    else if (_channel == CHANNEL_2 || _channel == CHANNEL_4)
-    {
-        writeValueToBytes(fspllcfg, 0x08400508L, LEN_FS_PLLCFG);
-        writeValueToBytes(fsplltune, 0x26, LEN_FS_PLLTUNE);
-    }
-    else if (_channel == CHANNEL_3)
-    {
-        writeValueToBytes(fspllcfg, 0x08401009L, LEN_FS_PLLCFG);
-        writeValueToBytes(fsplltune, 0x56, LEN_FS_PLLTUNE);
+        ch = 5;
     }
-    else if (_channel == CHANNEL_5 || _channel == CHANNEL_7)
-    {
-        writeValueToBytes(fspllcfg, 0x0800041DL, LEN_FS_PLLCFG);
-        writeValueToBytes(fsplltune, 0xBE, LEN_FS_PLLTUNE);
-    }
-    else
+    if (prf > 1 || rate > 2 || ch > 5 || _preambleCode > PREAMBLE_CODE_64MHZ_20 ||
+        pgm_read_word(&TUNE_LDE_REPC[_preambleCode]) == 0)
     {
         // TODO proper error/warning handling
+        return;
     }
-    // LDE_CFG1
-    writeValueToBytes(ldecfg1, 0xD, LEN_LDE_CFG1);
-    // LDE_CFG2
-    if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-    {
-        writeValueToBytes(ldecfg2, 0x1607, LEN_LDE_CFG2);
-    }
-    else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-    {
-        writeValueToBytes(ldecfg2, 0x0607, LEN_LDE_CFG2);
-    }
-    else
-    {
-        // TODO proper error/warning handling
-    }
-    // LDE_REPC
-    if (_preambleCode == PREAMBLE_CODE_16MHZ_1 || _preambleCode == PREAMBLE_CODE_16MHZ_2)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x5998 >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x5998, LEN_LDE_REPC);
-        }
-    }
-    else if (_preambleCode == PREAMBLE_CODE_16MHZ_3 || _preambleCode == PREAMBLE_CODE_16MHZ_8)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x51EA >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x51EA, LEN_LDE_REPC);
-        }
-    }
-    else if (_preambleCode == PREAMBLE_CODE_16MHZ_4)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x428E >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x428E, LEN_LDE_REPC);
-        }
-    }
-    else if (_preambleCode == PREAMBLE_CODE_16MHZ_5)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x451E >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x451E, LEN_LDE_REPC);
-        }
-    }
-    else if (_preambleCode == PREAMBLE_CODE_16MHZ_6)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x2E14 >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x2E14, LEN_LDE_REPC);
-        }
-    }
-    else if (_preambleCode == PREAMBLE_CODE_16MHZ_7)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x8000 >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x8000, LEN_LDE_REPC);
-        }
-    }
-    else if (_preambleCode == PREAMBLE_CODE_64MHZ_9)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x28F4 >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x28F4, LEN_LDE_REPC);
-        }
-    }
-    else if (_preambleCode == PREAMBLE_CODE_64MHZ_10 || _preambleCode == PREAMBLE_CODE_64MHZ_17)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x3332 >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x3332, LEN_LDE_REPC);
-        }
-    }
-    else if (_preambleCode == PREAMBLE_CODE_64MHZ_11)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x3AE0 >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x3AE0, LEN_LDE_REPC);
-        }
-    }
-    else if (_preambleCode == PREAMBLE_CODE_64MHZ_12)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x3D70 >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x3D70, LEN_LDE_REPC);
-        }
-    }
-    else if (_preambleCode == PREAMBLE_CODE_64MHZ_18 || _preambleCode == PREAMBLE_CODE_64MHZ_19)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x35C2 >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x35C2, LEN_LDE_REPC);
-        }
-    }
-    else if (_preambleCode == PREAMBLE_CODE_64MHZ_20)
-    {
-        if (_dataRate == TRX_RATE_110KBPS)
-        {
-            writeValueToBytes(lderepc, ((0x47AE >> 3) & 0xFFFF), LEN_LDE_REPC);
-        }
-        else
-        {
-            writeValueToBytes(lderepc, 0x47AE, LEN_LDE_REPC);
-        }
-    }
-    else
-    {
-        // TODO proper error/warning handling
-    }
-    // TX_POWER (enabled smart transmit power control)
-    if (_channel == CHANNEL_1 || _channel == CHANNEL_2)
-    {
-        if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-        {
-            if (_smartPower)
-            {
-                writeValueToBytes(txpower, 0x15355575L, LEN_TX_POWER);
-            }
-            else
-            {
-                writeValueToBytes(txpower, 0x75757575L, LEN_TX_POWER);
-            }
-        }
-        else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-        {
-            if (_smartPower)
-            {
-                writeValueToBytes(txpower, 0x07274767L, LEN_TX_POWER);
-            }
-            else
-            {
-                writeValueToBytes(txpower, 0x67676767L, LEN_TX_POWER);
-            }
-        }
-        else
-        {
-            // TODO proper error/warning handling
-        }
-    }
-    else if (_channel == CHANNEL_3)
+    uint32_t txpower;
+    if (_manualPowerSetting != 0)
     {
-        if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-        {
-            if (_smartPower)
-            {
-                writeValueToBytes(txpower, 0x0F2F4F6FL, LEN_TX_POWER);
-            }
-            else
-            {
-                writeValueToBytes(txpower, 0x6F6F6F6FL, LEN_TX_POWER);
-            }
-        }
-        else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-        {
-            if (_smartPower)
-            {
-                writeValueToBytes(txpower, 0x2B4B6B8BL, LEN_TX_POWER);
-            }
-            else
-            {
-                writeValueToBytes(txpower, 0x8B8B8B8BL, LEN_TX_POWER);
-            }
-        }
-        else
-        {
-            // TODO proper error/warning handling
-        }
+        txpower = (uint32_t)_manualPowerSetting;
     }
-    else if (_channel == CHANNEL_4)
+    else
     {
-        if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-        {
-            if (_smartPower)
-            {
-                writeValueToBytes(txpower, 0x1F1F3F5FL, LEN_TX_POWER);
-            }
-            else
-            {
-                writeValueToBytes(txpower, 0x5F5F5F5FL, LEN_TX_POWER);
-            }
-        }
-        else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-        {
-            if (_smartPower)
-            {
-                writeValueToBytes(txpower, 0x3A5A7A9AL, LEN_TX_POWER);
-            }
-            else
-            {
-                writeValueToBytes(txpower, 0x9A9A9A9AL, LEN_TX_POWER);
-            }
-        }
-        else
-        {
-            // TODO proper error/warning handling
-        }
+        txpower = pgm_read_dword(&TUNE_TX_POWER[ch][prf][_smartPower ? 1 : 0]);
     }
-    else if (_channel == CHANNEL_5)
+    byte txpowerBytes[LEN_TX_POWER];
+    writeValueToBytes(txpowerBytes, txpower, LEN_TX_POWER);
+    // nothing but (maybe) TX power to do if the chip is tuned to these parameters already
+    uint32_t key = ((uint32_t)_channel << 16) | ((uint32_t)_preambleCode << 8) |
+                   (uint32_t)((_preambleLength << 4) | (_pulseFrequency << 2) | _dataRate);
+    if ((_shadowValid & SHADOW_TUNE) && key == _tuneKey)
     {
-        if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-        {
-            if (_smartPower)
-            {
-                writeValueToBytes(txpower, 0x0E082848L, LEN_TX_POWER);
-            }
-            else
-            {
-                writeValueToBytes(txpower, 0x48484848L, LEN_TX_POWER);
-            }
-        }
-        else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-        {
-            if (_smartPower)
-            {
-                writeValueToBytes(txpower, 0x25456585L, LEN_TX_POWER);
-            }
-            else
-            {
-                writeValueToBytes(txpower, 0x85858585L, LEN_TX_POWER);
-            }
-        }
-        else
+        if (txpower != _tuneTxPower)
         {
-            // TODO proper error/warning handling
+            writeBytes(TX_POWER, NO_SUB, txpowerBytes, LEN_TX_POWER);
+            _tuneTxPower = txpower;
         }
+        return;
     }
-    else if (_channel == CHANNEL_7)
+    // these registers are going to be tuned/configured
+    byte agctune1[LEN_AGC_TUNE1];
+    byte agctune2[LEN_AGC_TUNE2];
+    byte agctune3[LEN_AGC_TUNE3];
+    byte drxtune0b[LEN_DRX_TUNE0b];
+    byte drxtune1a[LEN_DRX_TUNE1a];
+    byte drxtune1b[LEN_DRX_TUNE1b];
+    byte drxtune2[LEN_DRX_TUNE2];
+    byte drxtune4H[LEN_DRX_TUNE4H];
+    byte ldecfg1[LEN_LDE_CFG1];
+    byte ldecfg2[LEN_LDE_CFG2];
+    byte lderepc[LEN_LDE_REPC];
+    byte rfrxctrlh[LEN_RF_RXCTRLH];
+    byte rftxctrl[LEN_RF_TXCTRL];
+    byte tcpgdelay[LEN_TC_PGDELAY];
+    byte fspllcfg[LEN_FS_PLLCFG];
+    byte fsplltune[LEN_FS_PLLTUNE];
+    byte fsxtalt[LEN_FS_XTALT];
+    byte sfdLength;
+    // AGC_TUNE1/2/3
+    writeValueToBytes(agctune1, pgm_read_word(&TUNE_AGC_TUNE1[prf]), LEN_AGC_TUNE1);
+    writeValueToBytes(agctune2, 0x2502A907L, LEN_AGC_TUNE2);
+    writeValueToBytes(agctune3, 0x0035, LEN_AGC_TUNE3);
+    // DRX_TUNE0b, DRX_TUNE1a, DRX_TUNE1b, DRX_TUNE2
+    writeValueToBytes(drxtune0b, pgm_read_word(&TUNE_DRX_TUNE0b[rate]), LEN_DRX_TUNE0b);
+    writeValueToBytes(drxtune1a, pgm_read_word(&TUNE_DRX_TUNE1a[prf]), LEN_DRX_TUNE1a);
+    if (_preambleLength == TX_PREAMBLE_LEN_1536 || _preambleLength == TX_PREAMBLE_LEN_2048 ||
+        _preambleLength == TX_PREAMBLE_LEN_4096)
     {
-        if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
-        {
-            if (_smartPower)
-            {
-                writeValueToBytes(txpower, 0x32527292L, LEN_TX_POWER);
-            }
-            else
-            {
-                writeValueToBytes(txpower, 0x92929292L, LEN_TX_POWER);
-            }
-        }
-        else if (_pulseFrequency == TX_PULSE_FREQ_64MHZ)
-        {
-            if (_smartPower)
-            {
-                writeValueToBytes(txpower, 0x5171B1D1L, LEN_TX_POWER);
-            }
-            else
-            {
-                writeValueToBytes(txpower, 0xD1D1D1D1L, LEN_TX_POWER);
-            }
-        }
-        else
-        {
-            // TODO proper error/warning handling
-        }
+        writeValueToBytes(drxtune1b, 0x0064, LEN_DRX_TUNE1b); // 110 kb/s only
+    }
+    else if (_preambleLength != TX_PREAMBLE_LEN_64)
+    {
+        writeValueToBytes(drxtune1b, 0x0020, LEN_DRX_TUNE1b); // 850 kb/s and 6.8 Mb/s
     }
     else
     {
-        // TODO proper error/warning handling
+        writeValueToBytes(drxtune1b, 0x0010, LEN_DRX_TUNE1b); // 6.8 Mb/s only
     }
-
-    if (_manualPowerSetting != 0)
+    writeValueToBytes(drxtune2, pgm_read_dword(&TUNE_DRX_TUNE2[pac][prf]), LEN_DRX_TUNE2);
+    // DRX_TUNE4H
+    writeValueToBytes(drxtune4H, (_preambleLength == TX_PREAMBLE_LEN_64 ? 0x0010 : 0x0028), LEN_DRX_TUNE4H);
+    // RF_RXCTRLH and RF_TXCTRL
+    writeValueToBytes(rfrxctrlh, pgm_read_byte(&TUNE_RF_RXCTRLH[ch]), LEN_RF_RXCTRLH);
+    writeValueToBytes(rftxctrl, pgm_read_dword(&TUNE_RF_TXCTRL[ch]), LEN_RF_TXCTRL);
+    // TC_PGDELAY
+    writeValueToBytes(tcpgdelay, pgm_read_byte(&TUNE_TC_PGDELAY[ch]), LEN_TC_PGDELAY);
+    // FS_PLLCFG and FS_PLLTUNE
+    writeValueToBytes(fspllcfg, pgm_read_dword(&TUNE_FS_PLLCFG[ch]), LEN_FS_PLLCFG);
+    writeValueToBytes(fsplltune, pgm_read_byte(&TUNE_FS_PLLTUNE[ch]), LEN_FS_PLLTUNE);
+    // LDE_CFG1, LDE_CFG2 and LDE_REPC (to be scaled down for 110 kb/s)
+    writeValueToBytes(ldecfg1, 0xD, LEN_LDE_CFG1);
+    writeValueToBytes(ldecfg2, pgm_read_word(&TUNE_LDE_CFG2[prf]), LEN_LDE_CFG2);
+    uint16_t repc = pgm_read_word(&TUNE_LDE_REPC[_preambleCode]);
+    if (_dataRate == TRX_RATE_110KBPS)
     {
-        writeValueToBytes(txpower, _manualPowerSetting, LEN_TX_POWER);
+        repc >>= 3;
     }
-
-    // writeValueToBytes(txpower, 0x1F1F1F1FL, LEN_TX_POWER);
-
-    // Crystal calibration from OTP (if available)
-    byte buf_otp[4];
-    readBytesOTP(0x01E, buf_otp);
-    if (buf_otp[0] == 0)
+    writeValueToBytes(lderepc, repc, LEN_LDE_REPC);
+    // USR_SFD length
+    sfdLength = pgm_read_byte(&TUNE_SFD_LENGTH[rate]);
+    // Crystal calibration from OTP (if available, read once in select())
+    if (_xtalTrim == 0)
     {
         // No trim value available from OTP, use midrange value of 0x10
         writeValueToBytes(fsxtalt, ((0x10 & 0x1F) | 0x60), LEN_FS_XTALT);
     }
     else
     {
-        writeValueToBytes(fsxtalt, ((buf_otp[0] & 0x1F) | 0x60), LEN_FS_XTALT);
-    }
-    // write configuration back to chip
-    writeBytes(AGC_TUNE, AGC_TUNE1_SUB, agctune1, LEN_AGC_TUNE1);
-    writeBytes(AGC_TUNE, AGC_TUNE2_SUB, agctune2, LEN_AGC_TUNE2);
-    writeBytes(AGC_TUNE, AGC_TUNE3_SUB, agctune3, LEN_AGC_TUNE3);
-    writeBytes(DRX_TUNE, DRX_TUNE0b_SUB, drxtune0b, LEN_DRX_TUNE0b);
-    writeBytes(DRX_TUNE, DRX_TUNE1a_SUB, drxtune1a, LEN_DRX_TUNE1a);
-    writeBytes(DRX_TUNE, DRX_TUNE1b_SUB, drxtune1b, LEN_DRX_TUNE1b);
-    writeBytes(DRX_TUNE, DRX_TUNE2_SUB, drxtune2, LEN_DRX_TUNE2);
-    writeBytes(DRX_TUNE, DRX_TUNE4H_SUB, drxtune4H, LEN_DRX_TUNE4H);
-    writeBytes(LDE_IF, LDE_CFG1_SUB, ldecfg1, LEN_LDE_CFG1);
-    writeBytes(LDE_IF, LDE_CFG2_SUB, ldecfg2, LEN_LDE_CFG2);
-    writeBytes(LDE_IF, LDE_REPC_SUB, lderepc, LEN_LDE_REPC);
-    writeBytes(TX_POWER, NO_SUB, txpower, LEN_TX_POWER);
-    writeBytes(RF_CONF, RF_RXCTRLH_SUB, rfrxctrlh, LEN_RF_RXCTRLH);
-    writeBytes(RF_CONF, RF_TXCTRL_SUB, rftxctrl, LEN_RF_TXCTRL);
-    writeBytes(TX_CAL, TC_PGDELAY_SUB, tcpgdelay, LEN_TC_PGDELAY);
-    writeBytes(FS_CTRL, FS_PLLTUNE_SUB, fsplltune, LEN_FS_PLLTUNE);
-    writeBytes(FS_CTRL, FS_PLLCFG_SUB, fspllcfg, LEN_FS_PLLCFG);
-    writeBytes(FS_CTRL, FS_XTALT_SUB, fsxtalt, LEN_FS_XTALT);
+        writeValueToBytes(fsxtalt, ((_xtalTrim & 0x1F) | 0x60), LEN_FS_XTALT);
+    }
+    // write configuration back to chip in one transaction; DRX_TUNE0b to DRX_TUNE2 are adjacent, so
+    // transfer() merges their entries into a single burst, as one combined buffer would be written
+    const RegisterAccess accesses[] = {
+        {AGC_TUNE, AGC_TUNE1_SUB, agctune1, LEN_AGC_TUNE1, true},
+        {AGC_TUNE, AGC_TUNE2_SUB, agctune2, LEN_AGC_TUNE2, true},
+        {AGC_TUNE, AGC_TUNE3_SUB, agctune3, LEN_AGC_TUNE3, true},
+        {DRX_TUNE, DRX_TUNE0b_SUB, drxtune0b, LEN_DRX_TUNE0b, true},
+        {DRX_TUNE, DRX_TUNE1a_SUB, drxtune1a, LEN_DRX_TUNE1a, true},
+        {DRX_TUNE, DRX_TUNE1b_SUB, drxtune1b, LEN_DRX_TUNE1b, true},
+        {DRX_TUNE, DRX_TUNE2_SUB, drxtune2, LEN_DRX_TUNE2, true},
+        {DRX_TUNE, DRX_TUNE4H_SUB, drxtune4H, LEN_DRX_TUNE4H, true},
+        {LDE_IF, LDE_CFG1_SUB, ldecfg1, LEN_LDE_CFG1, true},
+        {LDE_IF, LDE_CFG2_SUB, ldecfg2, LEN_LDE_CFG2, true},
+        {LDE_IF, LDE_REPC_SUB, lderepc, LEN_LDE_REPC, true},
+        {TX_POWER, NO_SUB, txpowerBytes, LEN_TX_POWER, true},
+        {RF_CONF, RF_RXCTRLH_SUB, rfrxctrlh, LEN_RF_RXCTRLH, true},
+        {RF_CONF, RF_TXCTRL_SUB, rftxctrl, LEN_RF_TXCTRL, true},
+        {TX_CAL, TC_PGDELAY_SUB, tcpgdelay, LEN_TC_PGDELAY, true},
+        {FS_CTRL, FS_PLLCFG_SUB, fspllcfg, LEN_FS_PLLCFG, true},
+        {FS_CTRL, FS_PLLTUNE_SUB, fsplltune, LEN_FS_PLLTUNE, true},
+        {FS_CTRL, FS_XTALT_SUB, fsxtalt, LEN_FS_XTALT, true},
+        {USR_SFD, SFD_LENGTH_SUB, &sfdLength, LEN_SFD_LENGTH, true}};
+    transfer(accesses, sizeof(accesses) / sizeof(accesses[0]));
+    _tuneKey = key;
+    _tuneTxPower = txpower;
+    _shadowValid |= SHADOW_TUNE;
 }
 
 /* ###########################################################################
  * #### Interrupt handling ###################################################
  * ######################################################################### */
 
+void DW1000Class::serviceInterrupt(uint8_t slot)
+{
+    DW1000Hal::enterCritical();
+    boolean busy = (_busOwners != 0);
+    if (busy)
+    {
+        // the bus is in use (maybe mid-transfer), handled as soon as it is released
+        _irqPending[slot] = true;
+    }
+    else
+    {
+        _busOwners = 1;
+    }
+    DW1000Hal::exitCritical();
+    if (busy)
+    {
+        return;
+    }
+    _instances[slot]->handleInterrupt();
+    releaseBus();
+}
+
+void DW1000Class::releaseBus()
+{
+    DW1000Hal::enterCritical();
+    if (_busOwners > 1)
+    {
+        _busOwners--;
+        DW1000Hal::exitCritical();
+        return;
+    }
+    DW1000Hal::exitCritical();
+    for (;;)
+    {
+        // handle deferred interrupts while still owning the bus, so they cannot nest
+        for (uint8_t slot = 0; slot < DW1000_MAX_INSTANCES; slot++)
+        {
+            while (_irqPending[slot])
+            {
+                _irqPending[slot] = false;
+                _instances[slot]->handleInterrupt();
+            }
+        }
+        DW1000Hal::enterCritical();
+        _busOwners = 0;
+        DW1000Hal::exitCritical();
+        // an interrupt may have found the bus busy right before it was released; taken again only
+        // if no interrupt (maybe on another core) took it meanwhile, that one handles the flags then
+        DW1000Hal::enterCritical();
+        boolean retake = (isInterruptPending() && _busOwners == 0);
+        if (retake)
+        {
+            _busOwners = 1;
+        }
+        DW1000Hal::exitCritical();
+        if (!retake)
+        {
+            return;
+        }
+    }
+}
+
+boolean DW1000Class::isInterruptPending()
+{
+    for (uint8_t slot = 0; slot < DW1000_MAX_INSTANCES; slot++)
+    {
+        if (_irqPending[slot])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 void DW1000Class::handleInterrupt()
 {
+    // an event latched while the previous one is acknowledged keeps the interrupt line asserted,
+    // i.e. raises no further edge, so handle until the line is released
+    uint8_t rounds = 0;
+    do
+    {
+        handleEvent(DW1000Hal::micros());
+    } while (++rounds < IRQ_MAX_ROUNDS && DW1000Hal::digitalRead(_irq) == HIGH);
+}
 
-    uint32_t now = micros();
+void DW1000Class::useDeferredInterrupts(boolean val)
+{
+    _deferredInterrupts = val;
+}
 
+void DW1000Class::handleEvent(uint32_t now)
+{
     /*
     SYSTEM STATUS DEBUG
     */
@@ -1015,80 +820,195 @@ void DW1000Class::handleInterrupt()
     SYSTEM STATUS DEBUG
     */
 
-    // read current status and handle via callbacks
+    // read current status
     readSystemEventStatusRegister();
+    handleStatus(now);
+}
+
+void DW1000Class::handleStatus(uint32_t now)
+{
+    Event event;
+
+    event.status = (uint32_t)_sysstatus[0] | ((uint32_t)_sysstatus[1] << 8) |
+                   ((uint32_t)_sysstatus[2] << 16) | ((uint32_t)_sysstatus[3] << 24);
+    event.time = now;
+    // take the receive metadata while the frame is still in the buffer
+    boolean received = isReceiveDone();
+    if (received)
+    {
+        readRxFrameInfo();
+        // a later frame replaces _rxInfo before process() gets to this one
+        event.rxInfo = _rxInfo;
+        if (_doubleBuffered)
+        {
+            _rxBuffersHeld++;
+        }
+    }
+    // the chip is idle after a frame sent without the receiver to follow, after a frame received without
+    // permanent receive, double buffering or an acknowledgement to send, and after a receive timeout;
+    // events of a reception ended by newTransmit() come in with the transmission pending and do not count
+    boolean txDone = getBit(_sysstatus, LEN_SYS_STATUS, TXFRS_BIT) && _deviceMode == IDLE_MODE;
+    boolean rxDone = !_txPending && _deviceMode == RX_MODE &&
+                     (getBit(_sysstatus, LEN_SYS_STATUS, RXRFTO_BIT) || getBit(_sysstatus, LEN_SYS_STATUS, RXPTO_BIT) ||
+                      (received && !_permanentReceive && !_doubleBuffered &&
+                       !(getBit(_sysstatus, LEN_SYS_STATUS, AAT_BIT) && getBit(_syscfg, LEN_SYS_CFG, AUTOACK_BIT))));
+    if (txDone || rxDone)
+    {
+        _trxOff = true;
+        // all receive bits latched are acknowledged below, none come in with the receiver off
+        _rxStatusClean = _rxStatusClean || rxDone;
+    }
+#if DW1000_EVENT_RX_TIMESTAMP
+    if (_deferredInterrupts && isReceiveTimestampAvailable() && !received)
+    {
+        readBytes(RX_TIME, RX_STAMP_SUB, event.rxStamp, LEN_RX_STAMP);
+    }
+#endif
+    // acknowledge exactly what was read with a single write (write 1 to clear), events that
+    // come in meanwhile stay latched
+    writeBytes(SYS_STATUS, NO_SUB, _sysstatus, LEN_SYS_STATUS);
+
+    if (!_deferredInterrupts)
+    {
+        dispatchEvent(event);
+        return;
+    }
+    // queue for process()
+    uint8_t head = _eventHead;
+    if ((uint8_t)(head - _eventTail) >= DW1000_EVENT_RING_SIZE)
+    {
+        _droppedEvents++;
+        return;
+    }
+    _events[head & (DW1000_EVENT_RING_SIZE - 1)] = event;
+    // publish the completed event
+    _eventHead = head + 1;
+}
+
+uint8_t DW1000Class::process(uint8_t maxEvents)
+{
+    uint8_t handled = 0;
+    while (handled < maxEvents && _eventTail != _eventHead)
+    {
+        // copy out to free the slot before the callbacks run
+        Event event = _events[_eventTail & (DW1000_EVENT_RING_SIZE - 1)];
+        _eventTail++;
+        dispatchEvent(event);
+        handled++;
+    }
+    return handled;
+}
+
+void DW1000Class::dispatchEvent(const Event &event)
+{
+    boolean clockProblem, sent, timestampAvailable, failed, timeout, received, overrun, reenabled, acknowledged;
 
-    /*static boolean isRxPreambleDetected();
-		static boolean startOfRxFrame();
-		static boolean isTxPreambleSent();
-		static boolean isTxFrameSent();*/
+    // decode with the status helpers, without the interrupt handler refreshing _sysstatus meanwhile
+    acquireBus();
+    writeValueToBytes(_sysstatus, event.status, 4);
+    _sysstatus[4] = 0;
     if (startOfRxFrame())
     {
-        _rxFrameTime = now;
-        // Serial.print('r');
-        setBit(_sysstatus, LEN_SYS_STATUS, RXSFDD_BIT, true);
-        writeBytes(SYS_STATUS, NO_SUB, _sysstatus, LEN_SYS_STATUS);
+        _rxFrameTime = event.time;
     }
     if (isTxFrameSent())
     {
-        _txFrameTime = now;
-        // Serial.print('t');
-        setBit(_sysstatus, LEN_SYS_STATUS, TXFRB_BIT, true);
-        writeBytes(SYS_STATUS, NO_SUB, _sysstatus, LEN_SYS_STATUS);
+        _txFrameTime = event.time;
+    }
+    clockProblem = isClockProblem();
+    sent = isTransmitDone();
+    timestampAvailable = isReceiveTimestampAvailable();
+    failed = isReceiveFailed();
+    timeout = isReceiveTimeout();
+    received = isReceiveDone();
+    overrun = getBit(_sysstatus, LEN_SYS_STATUS, RXOVRR_BIT);
+    // RXAUTR turns the receiver on again after errors, but neither after a good frame nor after
+    // a frame wait or preamble timeout
+    reenabled = getBit(_syscfg, LEN_SYS_CFG, RXAUTR_BIT) && !received &&
+                !getBit(_sysstatus, LEN_SYS_STATUS, RXRFTO_BIT) && !getBit(_sysstatus, LEN_SYS_STATUS, RXPTO_BIT);
+    // the chip sends an acknowledgement of the frame, the next sent event is its own
+    if (received && getBit(_sysstatus, LEN_SYS_STATUS, AAT_BIT) && getBit(_syscfg, LEN_SYS_CFG, AUTOACK_BIT))
+    {
+        _ackPending = true;
+    }
+    acknowledged = sent && _ackPending && !_txPending;
+    if (acknowledged)
+    {
+        _ackPending = false;
+        sent = false;
+    }
+    releaseBus();
+    if (received)
+    {
+        // the metadata of this frame, maybe taken before others were received (deferred)
+        _rxInfo = event.rxInfo;
+        _rxInfoValid = true;
+    }
+    if (overrun)
+    {
+        // a frame was lost, the buffers are not to be trusted either: start over and report a failure
+        _rxOverruns++;
+        resetReceiver();
+        failed = true;
+        received = false;
+    }
+#if DW1000_EVENT_RX_TIMESTAMP
+    if (timestampAvailable && !received && _deferredInterrupts)
+    {
+        // captured by handleEvent() for deferred events only
+        _eventRxStamp = event.rxStamp;
     }
+#endif
 
-    if (isClockProblem() /* TODO and others */ && _handleError != 0)
+    // callbacks, the status is acknowledged already (i.e. restarting the receiver needs no clear)
+    if (clockProblem && _handleError != 0)
     {
         (*_handleError)();
-
-        //setBit(_sysstatus, LEN_SYS_STATUS, CLKPLL_LL_BIT, true);
-        //setBit(_sysstatus, LEN_SYS_STATUS, RFPLL_LL_BIT, true);
-        //writeBytes(SYS_STATUS, NO_SUB, _sysstatus, LEN_SYS_STATUS);
     }
-    if (isTransmitDone() && _handleSent != 0)
+    if (sent)
+    {
+        _txPending = false;
+    }
+    if (sent && _streamWaiting != 0)
+    {
+        // the next streamed frame is in the buffer already, on air before the handler runs
+        startStreamed();
+    }
+    if (sent && _handleSent != 0)
     {
-        // Serial.print('T');
         (*_handleSent)();
-        clearTransmitStatus();
     }
-    if (isReceiveTimestampAvailable() && _handleReceiveTimestampAvailable != 0)
+    if (timestampAvailable && _handleReceiveTimestampAvailable != 0)
     {
         (*_handleReceiveTimestampAvailable)();
-        clearReceiveTimestampAvailableStatus();
     }
-    if (isReceiveFailed() && _handleReceiveFailed != 0)
+    if (failed && _handleReceiveFailed != 0)
     {
         (*_handleReceiveFailed)();
-        clearReceiveStatus();
-        if (_permanentReceive)
-        {
-            newReceive();
-            startReceive();
-        }
     }
-    else if (isReceiveTimeout() && _handleReceiveTimeout != 0)
+    else if (timeout && _handleReceiveTimeout != 0)
     {
         (*_handleReceiveTimeout)();
-        clearReceiveStatus();
-        if (_permanentReceive)
-        {
-            newReceive();
-            startReceive();
-        }
     }
-    else if (isReceiveDone() && _handleReceived != 0)
+    else if (received && _handleReceived != 0)
     {
-        // Serial.print('R');
         (*_handleReceived)();
-        clearReceiveStatus();
-        if (_permanentReceive)
+    }
+    if (_permanentReceive && (received || failed || timeout || acknowledged))
+    {
+        if (received && _doubleBuffered)
+        {
+            // the receiver is still on, hand the buffer back for the frame after next
+            releaseReceiveBuffer();
+        }
+        else if (overrun || acknowledged || (!reenabled && !timeout && !_ackPending))
         {
-            newReceive();
-            startReceive();
+            // a frame wait or preamble timeout closes the receive window, it is not reopened; an
+            // acknowledgement on its way is not aborted, the receiver is turned on once it is out
+            restartReceive();
         }
     }
-    // clear all status that is left unhandled
-    clearAllStatus();
+    _eventRxStamp = 0;
 }
 
 /* ###########################################################################
@@ -1214,9 +1134,9 @@ void DW1000Class::getPrintableDeviceMode(char msgBuffer[])
     sprintf(msgBuffer, "Data rate: %u kb/s, PRF: %u MHz, Preamble: %u symbols (code #%u), Channel: #%u", dr, prf, plen, pcode, ch);
 }
 
-void DW1000Class::getPrintableSystemEventStatus(char msgBuffer[])
+void DW1000Class::getPrintableSystemEventStatus(char /* msgBuffer */[])
 {
-    byte data[LEN_SYS_STATUS];
+    // printed to Serial right away
     readBytes(SYS_STATUS, NO_SUB, _sysstatus, LEN_SYS_STATUS);
     Serial.println("===SYSTEM EVENT STATUS===");
     if(getBit(_sysstatus, LEN_SYS_STATUS, CPLOCK_BIT)) Serial.println("Clock PLL Lock");
@@ -1246,12 +1166,12 @@ void DW1000Class::getPrintableSystemEventStatus(char msgBuffer[])
 
 void DW1000Class::readSystemConfigurationRegister()
 {
-    readBytes(SYS_CFG, NO_SUB, _syscfg, LEN_SYS_CFG);
+    readShadowed(SYS_CFG, _syscfg, _syscfgShadow, LEN_SYS_CFG, SHADOW_SYS_CFG);
 }
 
 void DW1000Class::writeSystemConfigurationRegister()
 {
-    writeBytes(SYS_CFG, NO_SUB, _syscfg, LEN_SYS_CFG);
+    writeShadowed(SYS_CFG, _syscfg, _syscfgShadow, LEN_SYS_CFG, SHADOW_SYS_CFG);
 }
 
 void DW1000Class::readSystemEventStatusRegister()
@@ -1261,12 +1181,12 @@ void DW1000Class::readSystemEventStatusRegister()
 
 void DW1000Class::readNetworkIdAndDeviceAddress()
 {
-    readBytes(PANADR, NO_SUB, _networkAndAddress, LEN_PANADR);
+    readShadowed(PANADR, _networkAndAddress, _networkAndAddressShadow, LEN_PANADR, SHADOW_PANADR);
 }
 
 void DW1000Class::writeNetworkIdAndDeviceAddress()
 {
-    writeBytes(PANADR, NO_SUB, _networkAndAddress, LEN_PANADR);
+    writeShadowed(PANADR, _networkAndAddress, _networkAndAddressShadow, LEN_PANADR, SHADOW_PANADR);
 }
 
 void DW1000Class::readNetworkId()
@@ -1277,6 +1197,7 @@ void DW1000Class::readNetworkId()
 void DW1000Class::writeNetworkId()
 {
     writeBytes(PANADR, PAN_ID, _network, LEN_PAN_ID);
+    invalidateShadow(SHADOW_PANADR);
 }
 
 void DW1000Class::readDeviceAddress()
@@ -1287,36 +1208,96 @@ void DW1000Class::readDeviceAddress()
 void DW1000Class::writeDeviceAddress()
 {
     writeBytes(PANADR, SHORT_ADDR, _address, LEN_SHORT_ADDR);
+    invalidateShadow(SHADOW_PANADR);
 }
 
 void DW1000Class::readSystemEventMaskRegister()
 {
-    readBytes(SYS_MASK, NO_SUB, _sysmask, LEN_SYS_MASK);
+    readShadowed(SYS_MASK, _sysmask, _sysmaskShadow, LEN_SYS_MASK, SHADOW_SYS_MASK);
 }
 
 void DW1000Class::writeSystemEventMaskRegister()
 {
-    writeBytes(SYS_MASK, NO_SUB, _sysmask, LEN_SYS_MASK);
+    writeShadowed(SYS_MASK, _sysmask, _sysmaskShadow, LEN_SYS_MASK, SHADOW_SYS_MASK);
 }
 
 void DW1000Class::readChannelControlRegister()
 {
-    readBytes(CHAN_CTRL, NO_SUB, _chanctrl, LEN_CHAN_CTRL);
+    readShadowed(CHAN_CTRL, _chanctrl, _chanctrlShadow, LEN_CHAN_CTRL, SHADOW_CHAN_CTRL);
 }
 
 void DW1000Class::writeChannelControlRegister()
 {
-    writeBytes(CHAN_CTRL, NO_SUB, _chanctrl, LEN_CHAN_CTRL);
+    writeShadowed(CHAN_CTRL, _chanctrl, _chanctrlShadow, LEN_CHAN_CTRL, SHADOW_CHAN_CTRL);
 }
 
 void DW1000Class::readTransmitFrameControlRegister()
 {
-    readBytes(TX_FCTRL, NO_SUB, _txfctrl, LEN_TX_FCTRL);
+    readShadowed(TX_FCTRL, _txfctrl, _txfctrlShadow, LEN_TX_FCTRL, SHADOW_TX_FCTRL);
 }
 
 void DW1000Class::writeTransmitFrameControlRegister()
 {
-    writeBytes(TX_FCTRL, NO_SUB, _txfctrl, LEN_TX_FCTRL);
+    // frames of the same length and buffer offset as the last one leave it unchanged
+    commitShadowed(TX_FCTRL, _txfctrl, _txfctrlShadow, LEN_TX_FCTRL, SHADOW_TX_FCTRL);
+}
+
+void DW1000Class::readShadowed(byte reg, byte image[], byte shadow[], uint16_t n, uint32_t flag)
+{
+    readBytes(reg, NO_SUB, image, n);
+    memcpy(shadow, image, n);
+    _shadowValid |= flag;
+}
+
+void DW1000Class::writeShadowed(byte reg, byte image[], byte shadow[], uint16_t n, uint32_t flag)
+{
+    writeBytes(reg, NO_SUB, image, n);
+    memcpy(shadow, image, n);
+    _shadowValid |= flag;
+}
+
+/*
+ * Reset a register cache to the chip content, read back only if the shadow is not in sync.
+ */
+void DW1000Class::loadShadowed(byte reg, byte image[], byte shadow[], uint16_t n, uint32_t flag)
+{
+    if (_shadowValid & flag)
+    {
+        memcpy(image, shadow, n);
+    }
+    else
+    {
+        readShadowed(reg, image, shadow, n, flag);
+    }
+}
+
+/*
+ * Write a register cache to the chip, but only if it differs from what the chip holds.
+ */
+void DW1000Class::commitShadowed(byte reg, byte image[], byte shadow[], uint16_t n, uint32_t flag)
+{
+    if ((_shadowValid & flag) && memcmp(image, shadow, n) == 0)
+    {
+        return;
+    }
+    writeShadowed(reg, image, shadow, n, flag);
+}
+
+/*
+ * Make sure a register shadow holds the chip content, read back only if not in sync.
+ */
+void DW1000Class::fetchShadow(byte reg, uint16_t offset, byte shadow[], uint16_t n, uint32_t flag)
+{
+    if (!(_shadowValid & flag))
+    {
+        readBytes(reg, offset, shadow, n);
+        _shadowValid |= flag;
+    }
+}
+
+void DW1000Class::invalidateShadow(uint32_t flags)
+{
+    _shadowValid &= ~flags;
 }
 
 /* ###########################################################################
@@ -1479,9 +1460,62 @@ void DW1000Class::setFrameFilterAllowType5(boolean val)
     setBit(_syscfg, LEN_SYS_CFG, FFA5_BIT, val);
 }
 
+void DW1000Class::setAutoAcknowledge(boolean val)
+{
+    setBit(_syscfg, LEN_SYS_CFG, AUTOACK_BIT, val);
+}
+
+void DW1000Class::setAcknowledgeTime(uint8_t symbols)
+{
+    writeBytes(ACK_RESP_T, ACK_TIM_SUB, &symbols, LEN_ACK_TIM);
+}
+
 void DW1000Class::setDoubleBuffering(boolean val)
 {
+    _doubleBuffered = val;
     setBit(_syscfg, LEN_SYS_CFG, DIS_DRXB_BIT, !val);
+    setBit(_sysmask, LEN_SYS_MASK, RXOVRR_BIT, val);
+}
+
+void DW1000Class::releaseReceiveBuffer()
+{
+    acquireBus();
+    if (_rxBuffersHeld > 0)
+    {
+        // toggle the host side buffer (HRBPT), a frame in the other buffer is reported next
+        byte toggle = 1 << (HRBPT_BIT - 24);
+        _rxBuffersHeld--;
+        writeBytes(SYS_CTRL, 3, &toggle, 1);
+    }
+    releaseBus();
+}
+
+void DW1000Class::syncReceiveBuffers()
+{
+    // frames not handed back are dropped: point the host side at the buffer the chip fills next
+    byte pointers;
+    acquireBus();
+    readBytes(SYS_STATUS, 3, &pointers, 1);
+    if (((pointers >> (HSRBP_BIT - 24)) ^ (pointers >> (ICRBP_BIT - 24))) & 0x01)
+    {
+        byte toggle = 1 << (HRBPT_BIT - 24);
+        writeBytes(SYS_CTRL, 3, &toggle, 1);
+    }
+    _rxBuffersHeld = 0;
+    releaseBus();
+}
+
+void DW1000Class::resetReceiver()
+{
+    byte softReset;
+    acquireBus();
+    idle();
+    softReset = SOFTRESET_RX;
+    writeBytes(PMSC, PMSC_SOFTRESET_SUB, &softReset, 1);
+    softReset = SOFTRESET_CLEAR;
+    writeBytes(PMSC, PMSC_SOFTRESET_SUB, &softReset, 1);
+    _rxBuffersHeld = 0;
+    releaseBus();
 }
 
 void DW1000Class::setInterruptPolarity(boolean val)
@@ -1521,6 +1555,7 @@ void DW1000Class::interruptOnReceiveFailed(boolean val)
 void DW1000Class::interruptOnReceiveTimeout(boolean val)
 {
     setBit(_sysmask, LEN_SYS_MASK, RXRFTO_BIT, val);
+    setBit(_sysmask, LEN_SYS_MASK, RXPTO_BIT, val);
 }
 
 void DW1000Class::interruptOnReceiveTimestampAvailable(boolean val)
@@ -1565,22 +1600,67 @@ void DW1000Class::clearInterrupts()
 
 void DW1000Class::idle()
 {
+    _rxPending = false;
+    _ackPending = false;
+    _streamWaiting = 0;
+    memset(_sysctrl, 0, LEN_SYS_CTRL);
+    setBit(_sysctrl, LEN_SYS_CTRL, TRXOFF_BIT, true);
+    _deviceMode = IDLE_MODE;
+    // a receiver turned off latches no more bits, but those of its last moments may be there
+    _rxStatusClean = _rxStatusClean && _trxOff;
+    _trxOff = true;
+    writeBytes(SYS_CTRL, NO_SUB, _sysctrl, LEN_SYS_CTRL);
+}
+
+/*
+ * Same as idle(), without the SPI transaction if the chip turned the transceiver off itself already.
+ */
+void DW1000Class::idleIfActive()
+{
+    if (!_trxOff)
+    {
+        idle();
+        return;
+    }
+    _rxPending = false;
+    _ackPending = false;
+    _streamWaiting = 0;
     memset(_sysctrl, 0, LEN_SYS_CTRL);
-    setBit(_sysctrl, LEN_SYS_CTRL, TRXOFF_BIT, true);
     _deviceMode = IDLE_MODE;
-    writeBytes(SYS_CTRL, NO_SUB, _sysctrl, LEN_SYS_CTRL);
 }
 
 void DW1000Class::newReceive()
 {
-    idle();
+    acquireBus();
+    idleIfActive();
     memset(_sysctrl, 0, LEN_SYS_CTRL);
-    clearReceiveStatus();
+    if (!_rxStatusClean)
+    {
+        clearReceiveStatus();
+        _rxStatusClean = true;
+    }
+    _deviceMode = RX_MODE;
+    _rxInfoValid = false;
+    releaseBus();
+}
+
+void DW1000Class::restartReceive()
+{
+    // the receiver is off after a frame, an error or a timeout already, enabling it is all it takes
     _deviceMode = RX_MODE;
+    memset(_sysctrl, 0, LEN_SYS_CTRL);
+    startReceive();
 }
 
 void DW1000Class::startReceive()
 {
+    _pollInterval = _pollMin;
+    _trxOff = false;
+    _rxStatusClean = false;
+    if (_doubleBuffered)
+    {
+        syncReceiveBuffers();
+    }
     setBit(_sysctrl, LEN_SYS_CTRL, SFCST_BIT, !_frameCheck);
     setBit(_sysctrl, LEN_SYS_CTRL, RXENAB_BIT, true);
     writeBytes(SYS_CTRL, NO_SUB, _sysctrl, LEN_SYS_CTRL);
@@ -1588,19 +1668,52 @@ void DW1000Class::startReceive()
 
 void DW1000Class::newTransmit()
 {
-    idle();
+    acquireBus();
+    // the sent event of the last frame acknowledged its transmit bits already
+    boolean txStatus = _txPending || _ackPending;
+    idleIfActive();
     memset(_sysctrl, 0, LEN_SYS_CTRL);
-    clearTransmitStatus();
+    if (txStatus)
+    {
+        clearTransmitStatus();
+    }
     _deviceMode = TX_MODE;
+    releaseBus();
 }
 
-void DW1000Class::startTransmit()
+void DW1000Class::startTransmit(byte mode)
 {
+    boolean wait4resp = getBit(_sysctrl, LEN_SYS_CTRL, WAIT4RESP_BIT);
+    boolean thenReceive = (mode == TX_THEN_RX) || _permanentReceive;
+    acquireBus();
+    if (!wait4resp && mode == TX_THEN_RX && (_shadowValid & SHADOW_ACK_RESP_T) &&
+        (_w4rtim[0] | _w4rtim[1] | _w4rtim[2]) == 0)
+    {
+        // no response delay set: the chip turns the receiver on right after the frame, i.e. without
+        // a second SYS_CTRL write
+        wait4resp = true;
+        setBit(_sysctrl, LEN_SYS_CTRL, WAIT4RESP_BIT, true);
+    }
+    _txPending = true;
+    _trxOff = false;
+    _pollInterval = _pollMin;
+    if (wait4resp && _doubleBuffered)
+    {
+        syncReceiveBuffers();
+    }
     writeTransmitFrameControlRegister();
     setBit(_sysctrl, LEN_SYS_CTRL, SFCST_BIT, !_frameCheck);
     setBit(_sysctrl, LEN_SYS_CTRL, TXSTRT_BIT, true);
     writeBytes(SYS_CTRL, NO_SUB, _sysctrl, LEN_SYS_CTRL);
-    if (_permanentReceive)
+    if (wait4resp)
+    {
+        // the chip turns the receiver on after the frame
+        memset(_sysctrl, 0, LEN_SYS_CTRL);
+        _deviceMode = RX_MODE;
+        _rxInfoValid = false;
+        _rxStatusClean = false;
+    }
+    else if (thenReceive)
     {
         memset(_sysctrl, 0, LEN_SYS_CTRL);
         _deviceMode = RX_MODE;
@@ -1610,35 +1723,54 @@ void DW1000Class::startTransmit()
     {
         _deviceMode = IDLE_MODE;
     }
+    releaseBus();
 }
 
 void DW1000Class::newConfiguration()
 {
     idle();
-    readNetworkIdAndDeviceAddress();
-    readSystemConfigurationRegister();
-    readChannelControlRegister();
-    readTransmitFrameControlRegister();
-    readSystemEventMaskRegister();
+    // start from the chip configuration, only registers not known yet are read back
+    loadShadowed(PANADR, _networkAndAddress, _networkAndAddressShadow, LEN_PANADR, SHADOW_PANADR);
+    loadShadowed(SYS_CFG, _syscfg, _syscfgShadow, LEN_SYS_CFG, SHADOW_SYS_CFG);
+    loadShadowed(CHAN_CTRL, _chanctrl, _chanctrlShadow, LEN_CHAN_CTRL, SHADOW_CHAN_CTRL);
+    loadShadowed(TX_FCTRL, _txfctrl, _txfctrlShadow, LEN_TX_FCTRL, SHADOW_TX_FCTRL);
+    loadShadowed(SYS_MASK, _sysmask, _sysmaskShadow, LEN_SYS_MASK, SHADOW_SYS_MASK);
 }
 
 void DW1000Class::commitConfiguration()
 {
-    // write all configurations back to device
-    writeNetworkIdAndDeviceAddress();
-    writeSystemConfigurationRegister();
-    writeChannelControlRegister();
-    writeTransmitFrameControlRegister();
-    writeSystemEventMaskRegister();
-    // tune according to configuration
+    // write changed configurations back to device
+    commitShadowed(PANADR, _networkAndAddress, _networkAndAddressShadow, LEN_PANADR, SHADOW_PANADR);
+    commitShadowed(SYS_CFG, _syscfg, _syscfgShadow, LEN_SYS_CFG, SHADOW_SYS_CFG);
+    commitShadowed(CHAN_CTRL, _chanctrl, _chanctrlShadow, LEN_CHAN_CTRL, SHADOW_CHAN_CTRL);
+    commitShadowed(TX_FCTRL, _txfctrl, _txfctrlShadow, LEN_TX_FCTRL, SHADOW_TX_FCTRL);
+    commitShadowed(SYS_MASK, _sysmask, _sysmaskShadow, LEN_SYS_MASK, SHADOW_SYS_MASK);
+    // tune according to configuration (only writes if any of its parameters changed)
     tune();
     // TODO clean up code + antenna delay/calibration API
     // TODO setter + check not larger two bytes integer
-    byte antennaDelayBytes[LEN_STAMP];
-    writeValueToBytes(antennaDelayBytes, _antennaDelayValue, LEN_STAMP);
-    _antennaDelay.setTimestamp(antennaDelayBytes);
-    writeBytes(TX_ANTD, NO_SUB, antennaDelayBytes, LEN_TX_ANTD);
-    writeBytes(LDE_IF, LDE_RXANTD_SUB, antennaDelayBytes, LEN_LDE_RXANTD);
+    if (!(_shadowValid & SHADOW_ANTD))
+    {
+        byte antennaDelayBytes[LEN_STAMP];
+        writeValueToBytes(antennaDelayBytes, _antennaDelayValue, LEN_STAMP);
+        _antennaDelay.setTimestamp(antennaDelayBytes);
+        writeBytes(TX_ANTD, NO_SUB, antennaDelayBytes, LEN_TX_ANTD);
+        writeBytes(LDE_IF, LDE_RXANTD_SUB, antennaDelayBytes, LEN_LDE_RXANTD);
+        _shadowValid |= SHADOW_ANTD;
+    }
+}
+
+void DW1000Class::invalidateConfiguration()
+{
+    invalidateShadow(SHADOW_CONFIG);
+}
+
+void DW1000Class::resyncRegisters()
+{
+    invalidateShadow(SHADOW_ALL);
+    // the transceiver state and the status are not known either
+    _trxOff = false;
+    _rxStatusClean = false;
 }
 
 void DW1000Class::waitForResponse(boolean val)
@@ -1646,6 +1778,20 @@ void DW1000Class::waitForResponse(boolean val)
     setBit(_sysctrl, LEN_SYS_CTRL, WAIT4RESP_BIT, val);
 }
 
+void DW1000Class::setResponseDelay(uint32_t delayUs)
+{
+    // in units of 512 cycles of the 499.2 MHz clock, 20 bits
+    uint32_t w4r = delayUs < 1075000 ? delayUs * 39 / 40 : 0xFFFFF;
+    byte w4rtim[LEN_W4R_TIM];
+    writeValueToBytes(w4rtim, w4r, LEN_W4R_TIM);
+    if (!(_shadowValid & SHADOW_ACK_RESP_T) || memcmp(w4rtim, _w4rtim, LEN_W4R_TIM) != 0)
+    {
+        writeBytes(ACK_RESP_T, W4R_TIM_SUB, w4rtim, LEN_W4R_TIM);
+        memcpy(_w4rtim, w4rtim, LEN_W4R_TIM);
+        _shadowValid |= SHADOW_ACK_RESP_T;
+    }
+}
+
 void DW1000Class::suppressFrameCheck(boolean val)
 {
     _frameCheck = !val;
@@ -1660,7 +1806,106 @@ void DW1000Class::useSmartPower(boolean smartPower)
 void DW1000Class::setReceiveFrameWaitTimeout(uint16_t val){
     byte ReceiveFrameWaitTimeout[LEN_RX_FWTO];
     writeValueToBytes(ReceiveFrameWaitTimeout, val, LEN_RX_FWTO);
+    if ((_shadowValid & SHADOW_RX_FWTO) && memcmp(ReceiveFrameWaitTimeout, _rxfwto, LEN_RX_FWTO) == 0)
+    {
+        return;
+    }
     writeBytes(RX_FWTO, NO_SUB, ReceiveFrameWaitTimeout, LEN_RX_FWTO);
+    memcpy(_rxfwto, ReceiveFrameWaitTimeout, LEN_RX_FWTO);
+    _shadowValid |= SHADOW_RX_FWTO;
+}
+
+void DW1000Class::setReceiveTimeout(uint16_t us)
+{
+    if (us > 0)
+    {
+        // in units of 512 cycles of the 499.2 MHz clock, i.e. 1.026 us
+        uint16_t fwto = (uint16_t)((uint32_t)us * 39 / 40);
+        setReceiveFrameWaitTimeout(fwto > 0 ? fwto : 1);
+    }
+    setReceiveWaitTimeoutEnable(us > 0);
+    commitShadowed(SYS_CFG, _syscfg, _syscfgShadow, LEN_SYS_CFG, SHADOW_SYS_CFG);
+}
+
+void DW1000Class::setPreambleDetectTimeout(uint16_t us)
+{
+    // in PAC, the preamble symbol takes about 1 us
+    uint16_t pacs = (uint16_t)(((uint32_t)us + _pacSize - 1) / _pacSize);
+    byte pretoc[LEN_DRX_PRETOC];
+    writeValueToBytes(pretoc, pacs, LEN_DRX_PRETOC);
+    if ((_shadowValid & SHADOW_DRX_PRETOC) && memcmp(pretoc, _drxpretoc, LEN_DRX_PRETOC) == 0)
+    {
+        return;
+    }
+    writeBytes(DRX_TUNE, DRX_PRETOC_SUB, pretoc, LEN_DRX_PRETOC);
+    memcpy(_drxpretoc, pretoc, LEN_DRX_PRETOC);
+    _shadowValid |= SHADOW_DRX_PRETOC;
+}
+
+void DW1000Class::setSniffMode(uint8_t onPacs, uint8_t offUs)
+{
+    // the PLL is only switched off in the off periods with its sequencing enabled
+    fetchShadow(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, LEN_PMSC_CTRL0, SHADOW_PMSC_CTRL0);
+    if (getBit(_pmscctrl0, LEN_PMSC_CTRL0, PLL2_SEQ_EN_BIT) != (offUs > 0))
+    {
+        setBit(_pmscctrl0, LEN_PMSC_CTRL0, PLL2_SEQ_EN_BIT, offUs > 0);
+        writeBytes(PMSC, PMSC_CTRL0_SUB, _pmscctrl0, LEN_PMSC_CTRL0);
+    }
+    // SNIFF_ONT in the low nibble, SNIFF_OFFT in the second byte
+    byte sniff[LEN_RX_SNIFF];
+    writeValueToBytes(sniff, offUs > 0 ? ((uint32_t)offUs << 8) | (onPacs & 0x0F) : 0, LEN_RX_SNIFF);
+    if ((_shadowValid & SHADOW_RX_SNIFF) && memcmp(sniff, _rxsniff, LEN_RX_SNIFF) == 0)
+    {
+        return;
+    }
+    writeBytes(RX_SNIFF, NO_SUB, sniff, LEN_RX_SNIFF);
+    memcpy(_rxsniff, sniff, LEN_RX_SNIFF);
+    _shadowValid |= SHADOW_RX_SNIFF;
+}
+
+uint16_t DW1000Class::preambleSymbols()
+{
+    switch (_preambleLength)
+    {
+    case TX_PREAMBLE_LEN_64:
+        return 64;
+    case TX_PREAMBLE_LEN_128:
+        return 128;
+    case TX_PREAMBLE_LEN_256:
+        return 256;
+    case TX_PREAMBLE_LEN_512:
+        return 512;
+    case TX_PREAMBLE_LEN_1024:
+        return 1024;
+    case TX_PREAMBLE_LEN_1536:
+        return 1536;
+    case TX_PREAMBLE_LEN_2048:
+        return 2048;
+    default:
+        return 4096;
+    }
+}
+
+uint16_t DW1000Class::getPreambleTime()
+{
+    // the SFD takes 64 symbols at 110 kb/s and 8 otherwise
+    uint32_t symbols = preambleSymbols() + (_dataRate == TRX_RATE_110KBPS ? 64 : 8);
+    // of 993.6 ns (16 MHz PRF) or 1017.6 ns (64 MHz PRF)
+    return (uint16_t)(symbols * (_pulseFrequency == TX_PULSE_FREQ_16MHZ ? 9936 : 10176) / 10000);
+}
+
+void DW1000Class::useSniffMode(boolean val)
+{
+    uint16_t plen = preambleSymbols();
+    // on for two PAC, off for what the preamble (symbols of about 1 us) leaves of an off and two on
+    // periods, less one PAC of margin
+    int16_t offUs = (int16_t)plen - 5 * _pacSize;
+    if (!val || offUs <= 0)
+    {
+        setSniffMode(0, 0);
+        return;
+    }
+    setSniffMode(1, offUs > 255 ? 255 : (uint8_t)offUs);
 }
 
 void DW1000Class::getReceiveFrameWaitTimeout(){
@@ -1686,16 +1931,43 @@ DW1000Time DW1000Class::setDelay(const DW1000Time &delay)
         // in idle, ignore
         return DW1000Time();
     }
-    byte delayBytes[5];
     static DW1000Time futureTime;
     getSystemTimestamp(futureTime);
     futureTime += delay;
-    futureTime.getTimestamp(delayBytes);
+    return setDelayedTime(futureTime);
+}
+
+DW1000Time DW1000Class::setDelayedTime(const DW1000Time &time)
+{
+    if (_deviceMode == TX_MODE)
+    {
+        setBit(_sysctrl, LEN_SYS_CTRL, TXDLYS_BIT, true);
+    }
+    else if (_deviceMode == RX_MODE)
+    {
+        setBit(_sysctrl, LEN_SYS_CTRL, RXDLYS_BIT, true);
+    }
+    else
+    {
+        // in idle, ignore
+        return DW1000Time();
+    }
+    byte delayBytes[5];
+    time.getTimestamp(delayBytes);
     delayBytes[0] = 0; // User Manual Page74
     delayBytes[1] &= 0xFE;
     writeBytes(DX_TIME, NO_SUB, delayBytes, LEN_DX_TIME);
+    return getDelayedTimestamp(time);
+}
+
+DW1000Time DW1000Class::getDelayedTimestamp(const DW1000Time &time)
+{
+    byte delayBytes[5];
+    time.getTimestamp(delayBytes);
+    delayBytes[0] = 0;
+    delayBytes[1] &= 0xFE;
     // adjust expected time with configured antenna delay
-    futureTime.setTimestamp(delayBytes);
+    DW1000Time futureTime(delayBytes);
     futureTime += _antennaDelay;
     return futureTime;
 }
@@ -1773,20 +2045,6 @@ void DW1000Class::setDataRate(byte rate)
         setBit(_chanctrl, LEN_CHAN_CTRL, TNSSFD_BIT, false);
         setBit(_chanctrl, LEN_CHAN_CTRL, RNSSFD_BIT, false);
     }
-    byte sfdLength;
-    if (rate == TRX_RATE_6800KBPS)
-    {
-        sfdLength = 0x08;
-    }
-    else if (rate == TRX_RATE_850KBPS)
-    {
-        sfdLength = 0x10;
-    }
-    else
-    {
-        sfdLength = 0x40;
-    }
-    writeBytes(USR_SFD, SFD_LENGTH_SUB, &sfdLength, LEN_SFD_LENGTH);
     _dataRate = rate;
 }
 
@@ -1816,6 +2074,10 @@ int32_t DW1000Class::getManualPower()
 
 void DW1000Class::setAntennaDelay(int32_t delay)
 {
+    if (delay != _antennaDelayValue)
+    {
+        invalidateShadow(SHADOW_ANTD);
+    }
     _antennaDelayValue = delay;
 }
 
@@ -1858,12 +2120,10 @@ void DW1000Class::useExtendedFrameLength(boolean val)
 void DW1000Class::receivePermanently(boolean val)
 {
     _permanentReceive = val;
-    if (val)
-    {
-        // in case permanent, also reenable receiver once failed
-        setReceiverAutoReenable(true);
-        writeSystemConfigurationRegister();
-    }
+    // the chip re-enables its receiver after failed frames by itself, the driver only after good
+    // frames (only written if changed)
+    setReceiverAutoReenable(val);
+    commitShadowed(SYS_CFG, _syscfg, _syscfgShadow, LEN_SYS_CFG, SHADOW_SYS_CFG);
 }
 
 void DW1000Class::setChannel(byte channel)
@@ -1898,6 +2158,7 @@ void DW1000Class::setDefaults()
         suppressFrameCheck(false);
         //for global frame filtering
         setFrameFilter(false);
+        setAutoAcknowledge(false);
         //setFrameFilterAllowData(true);
         //setFrameFilterAllowReserved(true);
 		//setFrameFilterAllowReserved(true);
@@ -1926,34 +2187,112 @@ void DW1000Class::setDefaults()
     }
 }
 
-void DW1000Class::setData(byte data[], uint16_t n)
+boolean DW1000Class::setData(byte data[], uint16_t n)
+{
+    // length first (the chip appends the CRC), a frame too long leaves the buffer as it is
+    if (!setDataOffset(0, n))
+    {
+        return false;
+    }
+    writeBytes(TX_BUFFER, NO_SUB, data, n);
+    return true;
+}
+
+boolean DW1000Class::writeData(uint16_t offset, byte data[], uint16_t n)
+{
+    if (n == 0 || offset + n > LEN_TX_BUFFER)
+    {
+        return false;
+    }
+    writeBytes(TX_BUFFER, offset == 0 ? NO_SUB : offset, data, n);
+    return true;
+}
+
+boolean DW1000Class::streamData(byte data[], uint16_t n)
+{
+    uint16_t len = n + (_frameCheck ? 2 : 0); // two bytes CRC-16
+    if (_streamWaiting != 0 || n == 0 || len > LEN_TX_BUFFER / 2)
+    {
+        return false;
+    }
+    if (len > LEN_UWB_FRAMES && !_extendedFrameLength)
+    {
+        return false;
+    }
+    // the sent event of the frame on air cannot come in between
+    acquireBus();
+    if (!writeData((_streamHalf ^ 1) * (LEN_TX_BUFFER / 2), data, n))
+    {
+        releaseBus();
+        return false;
+    }
+    _streamHalf ^= 1;
+    _streamWaiting = n;
+    if (!_txPending)
+    {
+        startStreamed();
+    }
+    releaseBus();
+    return true;
+}
+
+/*
+ * Send the frame waiting in the transmit buffer half written last.
+ */
+void DW1000Class::startStreamed()
+{
+    uint16_t n = _streamWaiting;
+    _streamWaiting = 0;
+    if (!setDataOffset(_streamHalf * (LEN_TX_BUFFER / 2), n))
+    {
+        // checked by streamData() already, dropped rather than sending what the buffer holds
+        return;
+    }
+    if (_deviceMode == RX_MODE)
+    {
+        idle();
+    }
+    memset(_sysctrl, 0, LEN_SYS_CTRL);
+    _deviceMode = TX_MODE;
+    startTransmit();
+}
+
+boolean DW1000Class::setDataOffset(uint16_t offset, uint16_t n)
 {
     if (_frameCheck)
     {
         n += 2; // two bytes CRC-16
     }
-    if (n > LEN_EXT_UWB_FRAMES)
+    if (n > LEN_EXT_UWB_FRAMES || offset + n > LEN_TX_BUFFER)
     {
-        return; // TODO proper error handling: frame/buffer size
+        return false;
     }
     if (n > LEN_UWB_FRAMES && !_extendedFrameLength)
     {
-        return; // TODO proper error handling: frame/buffer size
+        return false;
     }
-    // transmit data and length
-    writeBytes(TX_BUFFER, NO_SUB, data, n);
     _txfctrl[0] = (byte)(n & 0xFF); // 1 byte (regular length + 1 bit)
     _txfctrl[1] &= 0xE0;
     _txfctrl[1] |= (byte)((n >> 8) & 0x03); // 2 added bits if extended length
+    // 10 bits of buffer offset
+    _txfctrl[2] &= 0x3F;
+    _txfctrl[2] |= (byte)((offset << (TXBOFFS_BIT - 16)) & 0xC0);
+    _txfctrl[3] = (byte)((offset >> 2) & 0xFF);
+    return true;
 }
 
-void DW1000Class::setData(const String &data)
+boolean DW1000Class::setData(const String &data)
 {
     uint16_t n = data.length() + 1;
     byte *dataBytes = (byte *)malloc(n);
+    if (dataBytes == nullptr)
+    {
+        return false;
+    }
     data.getBytes(dataBytes, n);
-    setData(dataBytes, n);
+    boolean written = setData(dataBytes, n);
     free(dataBytes);
+    return written;
 }
 
 // TODO reorder
@@ -1967,10 +2306,7 @@ uint16_t DW1000Class::getDataLength()
     }
     else if (_deviceMode == RX_MODE)
     {
-        // 10 bits of RX frame control register
-        byte rxFrameInfo[LEN_RX_FINFO];
-        readBytes(RX_FINFO, NO_SUB, rxFrameInfo, LEN_RX_FINFO);
-        len = ((((uint16_t)rxFrameInfo[1] << 8) | (uint16_t)rxFrameInfo[0]) & 0x03FF);
+        len = getRxFrameInfo().length;
     }
     if (_frameCheck && len > 2)
     {
@@ -2019,7 +2355,7 @@ void DW1000Class::getTransmitTimestamp(DW1000Time &time)
 void DW1000Class::getReceiveTimestamp(DW1000Time &time)
 {
     byte rxTimeBytes[LEN_RX_STAMP];
-    readBytes(RX_TIME, RX_STAMP_SUB, rxTimeBytes, LEN_RX_STAMP);
+    getReceiveTimestamp(rxTimeBytes);
     time.setTimestamp(rxTimeBytes);
     // correct timestamp (i.e. consider range bias)
     correctTimestamp(time); //MERGE NOTE saved a lot of time
@@ -2110,7 +2446,13 @@ void DW1000Class::getTransmitTimestamp(byte data[])
 
 void DW1000Class::getReceiveTimestamp(byte data[])
 {
-    readBytes(RX_TIME, RX_STAMP_SUB, data, LEN_RX_STAMP);
+    if (_eventRxStamp != 0)
+    {
+        // dispatching a deferred event, its timestamp was captured by the interrupt handler
+        memcpy(data, _eventRxStamp, LEN_RX_STAMP);
+        return;
+    }
+    memcpy(data, getRxFrameInfo().timestamp, LEN_RX_STAMP);
 }
 
 void DW1000Class::getSystemTimestamp(byte data[])
@@ -2225,6 +2567,10 @@ void DW1000Class::clearReceiveStatus()
     setBit(_sysstatus, LEN_SYS_STATUS, RXFCE_BIT, true);
     setBit(_sysstatus, LEN_SYS_STATUS, RXFCG_BIT, true);
     setBit(_sysstatus, LEN_SYS_STATUS, RXRFSL_BIT, true);
+    // timeouts as well, an old one would close the next reception (see handleStatus())
+    setBit(_sysstatus, LEN_SYS_STATUS, RXRFTO_BIT, true);
+    setBit(_sysstatus, LEN_SYS_STATUS, RXPTO_BIT, true);
+    setBit(_sysstatus, LEN_SYS_STATUS, RXSFDTO_BIT, true);
     writeBytes(SYS_STATUS, NO_SUB, _sysstatus, LEN_SYS_STATUS);
 }
 
@@ -2238,34 +2584,53 @@ void DW1000Class::clearTransmitStatus()
     writeBytes(SYS_STATUS, NO_SUB, _sysstatus, LEN_SYS_STATUS);
 }
 
+const DW1000Class::RxFrameInfo &DW1000Class::getRxFrameInfo()
+{
+    if (!_rxInfoValid)
+    {
+        readRxFrameInfo();
+    }
+    return _rxInfo;
+}
+
+void DW1000Class::readRxFrameInfo()
+{
+    byte rxFrameInfo[LEN_RX_FINFO];
+    // RX_STAMP, FP_INDEX and FP_AMPL1 are consecutive in RX_TIME
+    byte rxTime[FP_AMPL1_SUB + LEN_FP_AMPL1];
+    byte rxQuality[LEN_RX_FQUAL];
+    const RegisterAccess accesses[] = {
+        {RX_FINFO, NO_SUB, rxFrameInfo, LEN_RX_FINFO, false},
+        {RX_TIME, RX_STAMP_SUB, rxTime, sizeof(rxTime), false},
+        {RX_FQUAL, NO_SUB, rxQuality, LEN_RX_FQUAL, false}};
+    transfer(accesses, 3);
+    _rxInfo.length = (((uint16_t)rxFrameInfo[1] << 8) | (uint16_t)rxFrameInfo[0]) & 0x03FF;
+    _rxInfo.preambleAccumulation = (((uint16_t)rxFrameInfo[2] >> 4) & 0xFF) | ((uint16_t)rxFrameInfo[3] << 4);
+    memcpy(_rxInfo.timestamp, rxTime + RX_STAMP_SUB, LEN_RX_STAMP);
+    _rxInfo.firstPathIndex = (uint16_t)rxTime[LEN_RX_STAMP] | ((uint16_t)rxTime[LEN_RX_STAMP + 1] << 8);
+    _rxInfo.firstPathAmplitude1 = (uint16_t)rxTime[FP_AMPL1_SUB] | ((uint16_t)rxTime[FP_AMPL1_SUB + 1] << 8);
+    _rxInfo.noise = (uint16_t)rxQuality[STD_NOISE_SUB] | ((uint16_t)rxQuality[STD_NOISE_SUB + 1] << 8);
+    _rxInfo.firstPathAmplitude2 = (uint16_t)rxQuality[FP_AMPL2_SUB] | ((uint16_t)rxQuality[FP_AMPL2_SUB + 1] << 8);
+    _rxInfo.firstPathAmplitude3 = (uint16_t)rxQuality[FP_AMPL3_SUB] | ((uint16_t)rxQuality[FP_AMPL3_SUB + 1] << 8);
+    _rxInfo.channelImpulsePower = (uint16_t)rxQuality[CIR_PWR_SUB] | ((uint16_t)rxQuality[CIR_PWR_SUB + 1] << 8);
+    _rxInfoValid = true;
+}
+
 float DW1000Class::getReceiveQuality()
 {
-    byte noiseBytes[LEN_STD_NOISE];
-    byte fpAmpl2Bytes[LEN_FP_AMPL2];
-    uint16_t noise, f2;
-    readBytes(RX_FQUAL, STD_NOISE_SUB, noiseBytes, LEN_STD_NOISE);
-    readBytes(RX_FQUAL, FP_AMPL2_SUB, fpAmpl2Bytes, LEN_FP_AMPL2);
-    noise = (uint16_t)noiseBytes[0] | ((uint16_t)noiseBytes[1] << 8);
-    f2 = (uint16_t)fpAmpl2Bytes[0] | ((uint16_t)fpAmpl2Bytes[1] << 8);
-    return (float)f2 / noise;
+    const RxFrameInfo &info = getRxFrameInfo();
+    return (float)info.firstPathAmplitude2 / info.noise;
 }
 
 float DW1000Class::getFirstPathPower()
 {
-    byte fpAmpl1Bytes[LEN_FP_AMPL1];
-    byte fpAmpl2Bytes[LEN_FP_AMPL2];
-    byte fpAmpl3Bytes[LEN_FP_AMPL3];
-    byte rxFrameInfo[LEN_RX_FINFO];
-    uint16_t f1, f2, f3, N;
+    const RxFrameInfo &info = getRxFrameInfo();
+    float f1, f2, f3, N;
     float A, corrFac;
-    readBytes(RX_TIME, FP_AMPL1_SUB, fpAmpl1Bytes, LEN_FP_AMPL1);
-    readBytes(RX_FQUAL, FP_AMPL2_SUB, fpAmpl2Bytes, LEN_FP_AMPL2);
-    readBytes(RX_FQUAL, FP_AMPL3_SUB, fpAmpl3Bytes, LEN_FP_AMPL3);
-    readBytes(RX_FINFO, NO_SUB, rxFrameInfo, LEN_RX_FINFO);
-    f1 = (uint16_t)fpAmpl1Bytes[0] | ((uint16_t)fpAmpl1Bytes[1] << 8);
-    f2 = (uint16_t)fpAmpl2Bytes[0] | ((uint16_t)fpAmpl2Bytes[1] << 8);
-    f3 = (uint16_t)fpAmpl3Bytes[0] | ((uint16_t)fpAmpl3Bytes[1] << 8);
-    N = (((uint16_t)rxFrameInfo[2] >> 4) & 0xFF) | ((uint16_t)rxFrameInfo[3] << 4);
+    f1 = info.firstPathAmplitude1;
+    f2 = info.firstPathAmplitude2;
+    f3 = info.firstPathAmplitude3;
+    N = info.preambleAccumulation;
     if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
     {
         A = 113.77;
@@ -2276,7 +2641,7 @@ float DW1000Class::getFirstPathPower()
         A = 121.74;
         corrFac = 1.1667;
     }
-    float estFpPwr = 10.0 * log10(((float)f1 * (float)f1 + (float)f2 * (float)f2 + (float)f3 * (float)f3) / ((float)N * (float)N)) - A;
+    float estFpPwr = 10.0 * log10((f1 * f1 + f2 * f2 + f3 * f3) / (N * N)) - A;
     if (estFpPwr <= -88)
     {
         return estFpPwr;
@@ -2291,15 +2656,12 @@ float DW1000Class::getFirstPathPower()
 
 float DW1000Class::getReceivePower()
 {
-    byte cirPwrBytes[LEN_CIR_PWR];
-    byte rxFrameInfo[LEN_RX_FINFO];
+    const RxFrameInfo &info = getRxFrameInfo();
     uint32_t twoPower17 = 131072;
-    uint16_t C, N;
+    float C, N;
     float A, corrFac;
-    readBytes(RX_FQUAL, CIR_PWR_SUB, cirPwrBytes, LEN_CIR_PWR);
-    readBytes(RX_FINFO, NO_SUB, rxFrameInfo, LEN_RX_FINFO);
-    C = (uint16_t)cirPwrBytes[0] | ((uint16_t)cirPwrBytes[1] << 8);
-    N = (((uint16_t)rxFrameInfo[2] >> 4) & 0xFF) | ((uint16_t)rxFrameInfo[3] << 4);
+    C = info.channelImpulsePower;
+    N = info.preambleAccumulation;
     if (_pulseFrequency == TX_PULSE_FREQ_16MHZ)
     {
         A = 113.77;
@@ -2310,7 +2672,7 @@ float DW1000Class::getReceivePower()
         A = 121.74;
         corrFac = 1.1667;
     }
-    float estRxPwr = 10.0 * log10(((float)C * (float)twoPower17) / ((float)N * (float)N)) - A;
+    float estRxPwr = 10.0 * log10((C * (float)twoPower17) / (N * N)) - A;
     if (estRxPwr <= -88)
     {
         return estRxPwr;
@@ -2408,43 +2770,14 @@ void DW1000Class::writeValueToBytes(byte data[], int32_t val, uint16_t n)
 // TODO incomplete doc
 void DW1000Class::readBytes(byte cmd, uint16_t offset, byte data[], uint16_t n)
 {
-    byte header[3];
-    uint8_t headerLen = 1;
-    uint16_t i = 0;
-
-    // build SPI header
-    if (offset == NO_SUB)
-    {
-        header[0] = READ | cmd;
-    }
-    else
-    {
-        header[0] = READ_SUB | cmd;
-        if (offset < 128)
-        {
-            header[1] = (byte)offset;
-            headerLen++;
-        }
-        else
-        {
-            header[1] = RW_SUB_EXT | (byte)offset;
-            header[2] = (byte)(offset >> 7);
-            headerLen += 2;
-        }
-    }
-    SPI.beginTransaction(*_currentSPI);
-    digitalWrite(_ss, LOW);
-    for (i = 0; i < headerLen; i++)
-    {
-        SPI.transfer(header[i]); // send header
-    }
-    for (i = 0; i < n; i++)
-    {
-        data[i] = SPI.transfer(JUNK); // read values
-    }
-    delayMicroseconds(5);
-    digitalWrite(_ss, HIGH);
-    SPI.endTransaction();
+    acquireBus();
+    DW1000Hal::spiBeginTransaction(*_currentSPI);
+    spiSelect();
+    spiHeader(false, cmd, offset); // send header
+    spiRead(data, n);              // read values
+    spiDeselect();
+    DW1000Hal::spiEndTransaction();
+    releaseBus();
 }
 
 // always 4 bytes
@@ -2489,20 +2822,79 @@ void DW1000Class::writeByte(byte cmd, uint16_t offset, byte data)
  */
 // TODO offset really bigger than byte?
 void DW1000Class::writeBytes(byte cmd, uint16_t offset, byte data[], uint16_t data_size)
+{
+    // TODO proper error handling: address out of bounds
+    acquireBus();
+    DW1000Hal::spiBeginTransaction(*_currentSPI);
+    spiSelect();
+    spiHeader(true, cmd, offset); // send header
+    spiWrite(data, data_size);    // write values
+    spiDeselect();
+    DW1000Hal::spiEndTransaction();
+    releaseBus();
+}
+
+/*
+ * Run several register accesses in a single SPI transaction. Accesses that continue
+ * exactly where the previous one ended (same register, same direction, adjacent
+ * offset) are merged into one burst, i.e. share chip select cycle and header.
+ * @param accesses
+ *		The register accesses in the order they are done.
+ * @param count
+ *		The number of accesses.
+ */
+void DW1000Class::transfer(const RegisterAccess accesses[], uint8_t count)
+{
+    uint8_t i = 0;
+    acquireBus();
+    DW1000Hal::spiBeginTransaction(*_currentSPI);
+    while (i < count)
+    {
+        const RegisterAccess &first = accesses[i];
+        uint16_t next = (first.offset == NO_SUB ? 0 : first.offset);
+        spiSelect();
+        spiHeader(first.write, first.cmd, first.offset);
+        do
+        {
+            if (accesses[i].write)
+            {
+                spiWrite(accesses[i].data, accesses[i].n);
+            }
+            else
+            {
+                spiRead(accesses[i].data, accesses[i].n);
+            }
+            next += accesses[i].n;
+            i++;
+        } while (i < count && accesses[i].cmd == first.cmd && accesses[i].write == first.write &&
+                 accesses[i].offset != NO_SUB && accesses[i].offset == next);
+        spiDeselect();
+    }
+    DW1000Hal::spiEndTransaction();
+    releaseBus();
+}
+
+/*
+ * Send the SPI header of a register access (chip select already low).
+ * @param write
+ *		Whether the register is written or read.
+ * @param cmd
+ * 		The register address (see Chapter 7 in the DW1000 user manual).
+ * @param offset
+ *		The sub-address within the register, or NO_SUB.
+ */
+void DW1000Class::spiHeader(boolean write, byte cmd, uint16_t offset)
 {
     byte header[3];
     uint8_t headerLen = 1;
-    uint16_t i = 0;
 
-    // TODO proper error handling: address out of bounds
-    // build SPI header
     if (offset == NO_SUB)
     {
-        header[0] = WRITE | cmd;
+        header[0] = (write ? WRITE : READ) | cmd;
     }
     else
     {
-        header[0] = WRITE_SUB | cmd;
+        header[0] = (write ? WRITE_SUB : READ_SUB) | cmd;
         if (offset < 128)
         {
             header[1] = (byte)offset;
@@ -2515,19 +2907,69 @@ void DW1000Class::writeBytes(byte cmd, uint16_t offset, byte data[], uint16_t da
             headerLen += 2;
         }
     }
-    SPI.beginTransaction(*_currentSPI);
-    digitalWrite(_ss, LOW);
-    for (i = 0; i < headerLen; i++)
+    spiWrite(header, headerLen);
+}
+
+/*
+ * Pull chip select of the selected DW1000 low (SPI transaction already begun).
+ */
+void DW1000Class::spiSelect()
+{
+    DW1000Hal::digitalWrite(_ss, LOW);
+#if DW1000_SPI_STATS
+    _spiTransactions++;
+#endif
+}
+
+/*
+ * Raise chip select of the selected DW1000 after the configured hold time.
+ */
+void DW1000Class::spiDeselect()
+{
+    uint8_t hold = (_currentSPI == &_fastSPI ? _csHoldFast : _csHoldSlow);
+    if (hold > 0)
+    {
+        DW1000Hal::delayMicroseconds(hold);
+    }
+    DW1000Hal::digitalWrite(_ss, HIGH);
+}
+
+/*
+ * Clock n bytes in from the selected DW1000 (chip select already low).
+ * @param data
+ *		The data array to be read into.
+ * @param n
+ *		The number of bytes expected to be received.
+ */
+void DW1000Class::spiRead(byte data[], uint16_t n)
+{
+    if (n == 0)
     {
-        SPI.transfer(header[i]); // send header
+        return;
     }
-    for (i = 0; i < data_size; i++)
+#if DW1000_SPI_STATS
+    _spiBytes += n;
+#endif
+    DW1000Hal::spiRead(data, n);
+}
+
+/*
+ * Clock n bytes out to the selected DW1000 (chip select already low), read back data is discarded.
+ * @param data
+ *		The data array to be written, left untouched.
+ * @param n
+ *		The number of bytes to be written.
+ */
+void DW1000Class::spiWrite(const byte data[], uint16_t n)
+{
+    if (n == 0)
     {
-        SPI.transfer(data[i]); // write values
+        return;
     }
-    delayMicroseconds(5);
-    digitalWrite(_ss, HIGH);
-    SPI.endTransaction();
+#if DW1000_SPI_STATS
+    _spiBytes += n;
+#endif
+    DW1000Hal::spiWrite(data, n);
 }
 
 void DW1000Class::getPrettyBytes(byte data[], char msgBuffer[], uint16_t n)
@@ -2571,8 +3013,7 @@ void DW1000Class::getPrettyBytes(byte cmd, uint16_t offset, char msgBuffer[], ui
     for (i = 0; i < n; i++)
     {
         byte curByte = readBuf[i];
-        snprintf(&msgBuffer[b++], 2, "%d", (i + 1));
-        msgBuffer[b++] = (char)((i + 1) & 0xFF);
+        b += sprintf(&msgBuffer[b], "%d", i + 1);
         msgBuffer[b++] = ':';
         msgBuffer[b++] = ' ';
         for (j = 0; j < 8; j++)
@@ -2612,8 +3053,8 @@ void DW1000Class::getPrettyHex(byte data[], char msgBuffer[], uint16_t n)
 
 void DW1000Class::printPrettyHex(byte data[], uint16_t n, boolean newline)
 {
-    uint16_t i, b = 0;
-    char msg[2];
+    uint16_t i;
+    char msg[3];
     for (i = 0; i < n; i++)
     {
         byte curByte = data[i];
@@ -2629,7 +3070,6 @@ void DW1000Class::printPrettyHex(byte data[], uint16_t n, boolean newline)
 void DW1000Class::printPrettyBin(byte data[], uint16_t n, boolean newline)
 {
     uint16_t i;
-    char msg[2];
     for (i = 0; i < n; i++)
     {
         byte curByte = data[i];
@@ -19,10 +19,8 @@
  *
  * @todo
  * - impl: later:
- * - TXBOFFS in TX_FCTRL for offset buffer transmit
  * - TR in TX_FCTRL for flagging for ranging messages
  * - CANSFCS in SYS_CTRL to cancel frame check suppression
- * - HSRBP in SYS_CTRL to determine in double buffered mode from which buffer to read
  */
 
 #ifndef _DW1000_H_INCLUDED
@@ -32,21 +30,35 @@
 #include <stdlib.h>
 #include <string.h>
 #include <Arduino.h>
-#include <SPI.h>
+#include "DW1000CompileOptions.h"
 #include "DW1000Constants.h"
+#include "DW1000Hal.h"
 #include "DW1000Time.h"
 
+/**
+Driver of one DW1000 chip. `DW1000` is the default instance; further instances drive further chips
+on the same MCU independently (own select line, interrupt line, configuration and callbacks), see
+DW1000_MAX_INSTANCES.
+*/
 class DW1000Class {
 public:
+	DW1000Class();
+
 	/* ##### Init ################################################################ */
 	/**
 	Initiates and starts a sessions with one or more DW1000. If rst is not set or value 0xff, a soft resets (i.e. command
-	triggered) are used and it is assumed that no reset line is wired.
+	triggered) are used and it is assumed that no reset line is wired. The interrupt line is only attached
+	if less than DW1000_MAX_INSTANCES other instances have been begun and the line supports interrupts,
+	otherwise the instance falls back to polled operation. Without interrupt line (irq 0xff) the chip has to be serviced by calling `poll()`
+	frequently.
 
-	@param[in] irq The interrupt line/pin that connects the Arduino.
+	@param[in] irq The interrupt line/pin that connects the Arduino. Value 0xff means polled operation.
 	@param[in] rst The reset line/pin for hard resets of ICs that connect to the Arduino. Value 0xff means soft reset.
+
+	@return `false` if the interrupt line could not be attached (no free slot, or the HAL cannot watch the
+	line), i.e. the chip has to be serviced by `poll()`.
 	*/
-	static void begin(uint8_t irq, uint8_t rst = 0xff);
+	boolean begin(uint8_t irq, uint8_t rst = 0xff);
 
 	/**
 	Selects a specific DW1000 chip for communication. In case of a single DW1000 chip in use
@@ -56,61 +68,117 @@ public:
 	@param[in] ss The chip select line/pin that connects the to-be-selected chip with the
 	Arduino.
 	*/
-	static void select(uint8_t ss);
+	void select(uint8_t ss);
 
 	/**
 	(Re-)selects a specific DW1000 chip for communication. In case of a single DW1000 chip in use
 	this call is not needed; only a call to `select()` has to be performed once at start up. Other
 	than a call to `select()` this function does not perform an initial setup of the (again-)selected
-	chips and assumes it to have a valid configuration loaded.
+	chips and assumes it to have a valid configuration loaded. Chips switched this way share the
+	register caches of this instance; use one DW1000Class instance per chip to keep them apart.
 
 	@param[in] ss The chip select line/pin that connects the to-be-selected chip with the
 	Arduino.
 	*/
-	static void reselect(uint8_t ss);
+	void reselect(uint8_t ss);
 
 	/**
 	Tells the driver library that no communication to a DW1000 will be required anymore.
 	This basically just frees SPI and the previously used pins.
 	*/
-	static void end();
+	void end();
 
 	/**
 	Enable debounce Clock, used to clock the LED blinking
 	*/
-	static void enableDebounceClock();
+	void enableDebounceClock();
 
 	/**
 	Enable led blinking feature
 	*/
-	static void enableLedBlinking();
+	void enableLedBlinking();
 
 	/**
 	Set GPIO mode
 	*/
-	static void setGPIOMode(uint8_t msgp, uint8_t mode);
+	void setGPIOMode(uint8_t msgp, uint8_t mode);
 
         /**
         Enable deep sleep mode
         */
-        static void deepSleep();
+        void deepSleep();
 
         /**
         Wake-up from deep sleep by toggle chip select pin
         */
-        static void spiWakeup();
+        void spiWakeup();
 
 	/**
 	Resets all connected or the currently selected DW1000 chip. A hard reset of all chips
 	is preferred, although a soft reset of the currently selected one is executed if no
 	reset pin has been specified (when using `begin(int)`, instead of `begin(int, int)`).
 	*/
-	static void reset();
+	void reset();
 
 	/**
 	Resets the currently selected DW1000 chip programmatically (via corresponding commands).
 	*/
-	static void softReset();
+	void softReset();
+
+	/**
+	Services a chip without interrupt line (see `begin()`), to be called as often as possible, e.g. from
+	`loop()`. Reads the status at an adaptive interval: at the minimum while a transmission is in progress
+	or a frame is being received (i.e. its preamble was detected), doubling up to the maximum while nothing
+	happens. Events are handled just like by the
+	interrupt handler, i.e. the same callbacks are run (or queued, see `useDeferredInterrupts()`).
+
+	@return `true` if an event was handled.
+	*/
+	boolean poll();
+
+	/**
+	Sets the bounds of the adaptive poll interval (see `poll()`), defaults are `DW1000_POLL_MIN_US` and
+	`DW1000_POLL_MAX_US`.
+
+	@param[in] minUs Interval in micro seconds while an event is expected, 0 polls on every call.
+	@param[in] maxUs Interval in micro seconds the poll backs off to while nothing happens.
+	*/
+	void setPollInterval(uint16_t minUs, uint16_t maxUs);
+
+	/**
+	Sets how long chip select is held low after the last byte of a register access. A DW1000 needs
+	only some ns, so the default at the fast SPI clock is no wait at all (see `DW1000_CS_HOLD_FAST_US`).
+
+	@param[in] fastSpiUs Hold time in micro seconds while the fast SPI clock is used.
+	@param[in] slowSpiUs Hold time in micro seconds while the slow SPI clock (init, LDE load) is used.
+	*/
+	void setChipSelectHoldTime(uint8_t fastSpiUs, uint8_t slowSpiUs = DW1000_CS_HOLD_SLOW_US);
+
+	/**
+	Number of SPI transactions (i.e. chip select cycles) and payload bytes since the last call of
+	`resetSpiStats()`. Only counted if `DW1000_SPI_STATS` is enabled, 0 otherwise.
+	*/
+	uint32_t getSpiTransactionCount();
+	uint32_t getSpiByteCount();
+	void     resetSpiStats();
+
+	/**
+	Takes the SPI bus for a sequence of driver calls that must not be interleaved with interrupt handling,
+	e.g. preparing and starting a transmission. Interrupts of the DW1000 chips (of all instances) that
+	come in meanwhile are deferred, not lost, until the bus is released. Calls nest; every driver call
+	holds the bus while it talks to a chip anyway.
+	*/
+	static void acquireBus() {
+		DW1000Hal::enterCritical();
+		_busOwners++;
+		DW1000Hal::exitCritical();
+	}
+
+	/**
+	Releases the SPI bus (see acquireBus()). The last release handles the interrupts that were deferred
+	meanwhile, i.e. callbacks may be run from here.
+	*/
+	static void releaseBus();
 
 	/* ##### Print device id, address, etc. ###################################### */
 	/**
@@ -120,7 +188,7 @@ public:
 	@param[out] msgBuffer The String buffer to be filled with printable device information.
 		Provide 128 bytes, this should be sufficient.
 	*/
-	static void getPrintableDeviceIdentifier(char msgBuffer[]);
+	void getPrintableDeviceIdentifier(char msgBuffer[]);
 
 	/**
 	Generates a String representation of the extended unique identifier (EUI) of the chip.
@@ -128,7 +196,7 @@ public:
 	@param[out] msgBuffer The String buffer to be filled with printable device information.
 		Provide 128 bytes, this should be sufficient.
 	*/
-	static void getPrintableExtendedUniqueIdentifier(char msgBuffer[]);
+	void getPrintableExtendedUniqueIdentifier(char msgBuffer[]);
 
 	/**
 	Generates a String representation of the short address and network identifier currently
@@ -137,7 +205,7 @@ public:
 	@param[out] msgBuffer The String buffer to be filled with printable device information.
 		Provide 128 bytes, this should be sufficient.
 	*/
-	static void getPrintableNetworkIdAndShortAddress(char msgBuffer[]);
+	void getPrintableNetworkIdAndShortAddress(char msgBuffer[]);
 
 	/**
 	Generates a String representation of the main operational settings of the chip. This
@@ -146,7 +214,7 @@ public:
 	@param[out] msgBuffer The String buffer to be filled with printable device information.
 		Provide 128 bytes, this should be sufficient.
 	*/
-	static void getPrintableDeviceMode(char msgBuffer[]);
+	void getPrintableDeviceMode(char msgBuffer[]);
 
 	/**
 	Generates a String representation of the System Event Status
@@ -154,7 +222,7 @@ public:
 	@param[out] msgBuffer The String buffer to be filled with printable device information.
 		Provide 128 bytes, this should be sufficient.
 	*/
-	static void getPrintableSystemEventStatus(char msgBuffer[]);
+	void getPrintableSystemEventStatus(char msgBuffer[]);
 
 	/* ##### Device address management, filters ################################## */
 	/**
@@ -166,9 +234,9 @@ public:
 
 
 	// CUSTOM
-	static void getTransmitPower(char msgBuffer[]);
+	void getTransmitPower(char msgBuffer[]);
 
-	static void setNetworkId(uint16_t val);
+	void setNetworkId(uint16_t val);
 
 	/**
 	(Re-)set the device address (i.e. short address) for the currently selected chip. This
@@ -176,11 +244,59 @@ public:
 
 	@param[in] val An arbitrary numeric device address.
 	*/
-	static void setDeviceAddress(uint16_t val);
-	// TODO MAC and filters
+	void setDeviceAddress(uint16_t val);
+
+	/**
+	Specifies whether the DW1000 chip filters received frames in hardware (IEEE 802.15.4 MAC frame
+	filtering). Frames of a type not allowed, or data, acknowledgement and MAC command frames not
+	addressed to the network identifier and device address (or extended unique identifier) of the
+	chip, are rejected without a received interrupt; broadcast (0xFFFF) is accepted. With receiver
+	auto-reenable (see `receivePermanently()`) the chip goes on listening by itself, otherwise its
+	receiver is off after a rejected frame.
 
-	static void setEUI(char eui[]);
-	static void setEUI(byte eui[]);
+	Frame filtering is disabled as part of `setDefaults()` if the device is in idle mode. The
+	settings take effect with `commitConfiguration()`.
+
+	@param[in] val `true` to enable, `false` to disable frame filtering.
+	*/
+	void setFrameFilter(boolean val);
+	void setFrameFilterBehaveCoordinator(boolean val);
+	void setFrameFilterAllowBeacon(boolean val);
+	// data type is used in the FC_1 0x41
+	void setFrameFilterAllowData(boolean val);
+	void setFrameFilterAllowAcknowledgement(boolean val);
+	void setFrameFilterAllowMAC(boolean val);
+	// reserved frame types, others than 4 and 5
+	void setFrameFilterAllowReserved(boolean val);
+	void setFrameFilterAllowType4(boolean val);
+	// type 5 is used for the Blink message (FC_1_BLINK 0xC5)
+	void setFrameFilterAllowType5(boolean val);
+
+	/**
+	Specifies whether the DW1000 chip acknowledges received data and MAC command frames that request
+	an acknowledgement by itself. Only frames that passed frame filtering (see `setFrameFilter()`)
+	and are not broadcast are acknowledged. The acknowledgement goes out after the turnaround time
+	set with `setAcknowledgeTime()`; the driver does not report it as sent and, in permanent receive
+	mode, turns the receiver on again once it is out. Starting a transmission or reception from the
+	received handler aborts a pending acknowledgement.
+
+	Auto-acknowledge is disabled as part of `setDefaults()` if the device is in idle mode. The
+	setting takes effect with `commitConfiguration()`.
+
+	@param[in] val `true` to enable, `false` to disable auto-acknowledge.
+	*/
+	void setAutoAcknowledge(boolean val);
+
+	/**
+	Sets the turnaround time from the end of a received frame to the acknowledgement the chip sends
+	(see `setAutoAcknowledge()`), in preamble symbols. Written to the chip immediately.
+
+	@param[in] symbols Turnaround time in preamble symbols (about 1 us each), 0 for the shortest.
+	*/
+	void setAcknowledgeTime(uint8_t symbols);
+
+	void setEUI(char eui[]);
+	void setEUI(byte eui[]);
 
 	/* ##### General device configuration ######################################## */
 	
@@ -188,12 +304,27 @@ public:
 	Specifies whether the DW1000 chip should, again, turn on its receiver in case that the
 	last reception failed.
 
-	This setting is enabled as part of `setDefaults()` if the device is
-	in idle mode.
+	This setting is enabled and disabled by `receivePermanently()`; the driver then leaves failed
+	frames to the chip and only restarts the receiver after good frames (a receive timeout, see
+	`setReceiveTimeout()`, ends permanent receive mode).
 
 	@param[in] val `true` to enable, `false` to disable receiver auto-reenable.
 	*/
-	static void setReceiverAutoReenable(boolean val);
+	void setReceiverAutoReenable(boolean val);
+
+	/**
+	Specifies whether the DW1000 chip receives into two alternating buffers. While the host reads a
+	frame, the receiver stays on and takes the next one into the other buffer; the buffer is handed
+	back to the chip after the received handler returns (with `receivePermanently()`) or with the next
+	`startReceive()`. A frame arriving while both buffers are full is lost: the receiver is reset,
+	the receive failed handler runs and `getReceiveOverrunCount()` counts it.
+
+	Double buffering is disabled by `select()`.
+
+	@param[in] val `true` to enable, `false` to disable the double receive buffer.
+	*/
+	void setDoubleBuffering(boolean val);
+	uint16_t getReceiveOverrunCount() { return _rxOverruns; }
 
 	/**
 	Receive Wait Timeout Enable. 
@@ -202,7 +333,7 @@ public:
 
 	@param[in] val `true` to enable, `false` to disable Receive Wait Timeout.
 	*/
-	static void setReceiveWaitTimeoutEnable(boolean val);
+	void setReceiveWaitTimeoutEnable(boolean val);
 	/**
 	Specifies the interrupt polarity of the DW1000 chip.
 
@@ -211,7 +342,7 @@ public:
 
 	@param[in] val `true` for active high interrupts, `false` for active low interrupts.
 	*/
-	static void setInterruptPolarity(boolean val);
+	void setInterruptPolarity(boolean val);
 
 	/**
 	Specifies whether to suppress any frame check measures while sending or receiving messages.
@@ -224,7 +355,7 @@ public:
 
 	@param[in] val `true` to suppress frame check on sender and receiver side, `false` otherwise.
 	*/
-	static void suppressFrameCheck(boolean val);
+	void suppressFrameCheck(boolean val);
 
 	/**
 	Specifies the data transmission rate of the DW1000 chip. One of the values
@@ -237,7 +368,7 @@ public:
 
 	@param[in] rate The data transmission rate, encoded by the above defined constants.
 	*/
-	static void setDataRate(byte rate);
+	void setDataRate(byte rate);
 
 	/**
 	Specifies the pulse repetition frequency (PRF) of data transmissions with the DW1000. Either
@@ -253,19 +384,19 @@ public:
 
 	@param[in] freq The PRF, encoded by the above defined constants.
 	*/
-	static void setPulseFrequency(byte freq);
-	static byte getPulseFrequency();
+	void setPulseFrequency(byte freq);
+	byte getPulseFrequency();
 
-	static void setAntennaDelay(int32_t delay);
-	static int32_t getAntennaDelay();
+	void setAntennaDelay(int32_t delay);
+	int32_t getAntennaDelay();
 
-	static void setManualPower(int32_t power);
-	static int32_t getManualPower();
+	void setManualPower(int32_t power);
+	int32_t getManualPower();
 
-	static void setPreambleLength(byte prealen);
-	static void setChannel(byte channel);
-	static void setPreambleCode(byte preacode);
-	static void useSmartPower(boolean smartPower);
+	void setPreambleLength(byte prealen);
+	void setChannel(byte channel);
+	void setPreambleCode(byte preacode);
+	void useSmartPower(boolean smartPower);
 
 	/* transmit and receive configuration. */
 
@@ -276,90 +407,304 @@ public:
 	greater than the expected RX frame duration and include an allowance for any uncertainly
 	attaching to the expected transmission start time of the awaited frame.
 	*/
-	static void 		setReceiveFrameWaitTimeout(uint16_t val);
-	static void 		getReceiveFrameWaitTimeout();
-	static DW1000Time   setDelay(const DW1000Time& delay);
-	static DW1000Time   setDelayFromRx(const DW1000Time& delay);
-	static void         receivePermanently(boolean val);
-	static void         setData(byte data[], uint16_t n);
-	static void         setData(const String& data);
-	static void         getData(byte data[], uint16_t n);
-	static void         getData(String& data);
-	static uint16_t     getDataLength();
-	static void         getTransmitTimestamp(DW1000Time& time);
-	static void         getReceiveTimestamp(DW1000Time& time);
-	static void         getSystemTimestamp(DW1000Time& time);
-	static void         getTransmitTimestamp(byte data[]);
-	static void         getReceiveTimestamp(byte data[]);
-	static void         getSystemTimestamp(byte data[]);
+	void 		setReceiveFrameWaitTimeout(uint16_t val);
+	void 		getReceiveFrameWaitTimeout();
+
+	/**
+	Bounds the following receive sessions: the receiver turns off with a receive timeout
+	event if no frame was received within the given time after it turned on (i.e. after
+	`startReceive()`, or at the delayed receive time). This also ends permanent receive
+	mode, the timeout is not followed by a restart.
+
+	Written to the chip immediately (the enable bit only if changed).
+
+	@param[in] us Frame wait timeout in microseconds, `0` to wait without timeout.
+	*/
+	void         setReceiveTimeout(uint16_t us);
+
+	/**
+	Preamble detection timeout: the receiver turns off with a receive timeout event if no
+	preamble was detected within the given time after it turned on. Other than the frame
+	wait timeout this does not need to allow for the frame duration, so an empty receive
+	window closes as soon as the reply is overdue.
+
+	Counted in preamble acquisition chunks (PAC, 8 to 64 symbols of about 1 us depending
+	on the preamble length), so the configuration has to be committed before. Written to
+	the chip immediately, but only if changed.
+
+	@param[in] us Preamble detection timeout in microseconds (rounded up to full PAC), `0` to disable.
+	*/
+	void         setPreambleDetectTimeout(uint16_t us);
+
+	/**
+	Preamble sniff mode: while hunting for a preamble the receiver is on for `onPacs`+1 preamble
+	acquisition chunks (PAC, see `setPreambleDetectTimeout()`) and off for `offUs` in turn, which
+	cuts the average current of a listening receiver roughly by the on/(on+off) ratio. A frame is
+	still detected if its preamble spans an off and two on periods; once a preamble is found the
+	receiver stays on for the frame.
+
+	Applies to every following reception, also the restarts of permanent receive mode. Sets the PLL
+	sequencing (PLL2_SEQ_EN) along, without which the receiver is not switched off in the off periods.
+	Written to the chip immediately, but only if changed.
+
+	@param[in] onPacs On time in PAC (the chip adds one), up to 15.
+	@param[in] offUs Off time in microseconds (about), `0` to disable sniff mode.
+	*/
+	void         setSniffMode(uint8_t onPacs, uint8_t offUs);
+
+	/**
+	Preamble sniff mode (see `setSniffMode()`) with the longest off time that still detects every
+	preamble of the configured length (about 15% on time with 128 symbols, a third with 2048 and more),
+	so the configuration has to be committed before.
+
+	@param[in] val `true` to enable, `false` to disable sniff mode.
+	*/
+	void         useSniffMode(boolean val);
+
+	/**
+	The time the transmitter starts before the send time of a delayed frame (see `setDelay()`), which
+	is the end of its preamble and start of frame delimiter. A delayed frame has to be started earlier
+	than that. Depends on the configuration, so it has to be committed before.
+
+	@return Preamble and SFD duration in microseconds.
+	*/
+	uint16_t     getPreambleTime();
+
+	/**
+	Turns the receiver on by itself after the frame to be sent (WAIT4RESP), after the turnaround set with
+	`setResponseDelay()`, so a reply window opens without the SPI traffic and the interrupt latency of a
+	`newReceive()`/`startReceive()` from the sent handler. The receive session uses the current receive
+	settings (timeouts, sniff mode) and is reported like one started by `startReceive()`; permanent
+	receive mode does not turn the receiver on right after the frame then.
+
+	Call between `newTransmit()` and `startTransmit()`, for this frame only.
+
+	@param[in] val `true` to turn the receiver on after the frame, `false` not to.
+	*/
+	void         waitForResponse(boolean val);
+
+	/**
+	Receiver turn-on delay after the end of a frame sent with `waitForResponse()` (W4R_TIM in
+	ACK_RESP_T). Kept for the following frames, written to the chip immediately, but only if changed.
+
+	@param[in] delayUs Delay in microseconds (about, up to about one second), `0` for the shortest.
+	*/
+	void         setResponseDelay(uint32_t delayUs);
+	DW1000Time   setDelay(const DW1000Time& delay);
+
+	/**
+	Delayed transmit or receive at a system time instead of a delay from now (see `setDelay()`), e.g.
+	one worked out before the session started.
+
+	@param[in] time The system time, the chip starts at multiples of 512 ticks (about 8 ns) and ignores
+	the low bits.
+	@return The expected timestamp, see `getDelayedTimestamp()`.
+	*/
+	DW1000Time   setDelayedTime(const DW1000Time& time);
+
+	/**
+	The timestamp a frame delayed to `time` (see `setDelayedTime()`) gets: the time without its low 9
+	bits plus the antenna delay. No SPI transfer, so a frame can carry its own transmit time before
+	anything is written to the chip.
+	*/
+	DW1000Time   getDelayedTimestamp(const DW1000Time& time);
+	DW1000Time   setDelayFromRx(const DW1000Time& delay);
+	void         receivePermanently(boolean val);
+
+	/**
+	Writes the frame to be sent on the next `startTransmit()` to the start of the transmit buffer.
+
+	@param[in] data The frame (without frame check sequence).
+	@param[in] n The number of bytes.
+	@return `false` if the frame is too long (also for the frame length mode), nothing is written then.
+	*/
+	boolean      setData(byte data[], uint16_t n);
+	boolean      setData(const String& data);
+
+	/**
+	Writes into the transmit buffer at an offset, the frame to be sent stays as it is. With
+	`setDataOffset()` several frames can be kept in the buffer (1024 bytes) and sent again with only
+	their changing bytes rewritten.
+
+	@return `false` if nothing or more than the buffer holds from `offset` is to be written.
+	*/
+	boolean      writeData(uint16_t offset, byte data[], uint16_t n);
+
+	/**
+	Sends the `n` bytes (frame check sequence not counted) at `offset` in the transmit buffer on the
+	next `startTransmit()` (TXBOFFS and frame length in TX_FCTRL).
+
+	@return `false` if the frame is too long (also for the frame length mode) or exceeds the buffer,
+	the frame to be sent stays as it is then.
+	*/
+	boolean      setDataOffset(uint16_t offset, uint16_t n);
+
+	/**
+	Streaming transmit of frames back to back. The frames go to alternating halves of the transmit
+	buffer: while one is on air the next one is uploaded into the other half and started from the sent
+	event of the first, so SPI transfer and air time overlap. The sent handler runs for each frame (the
+	following one is on air already) and may stream the next. No delay, sent at once if the
+	transmitter is free; `idle()`, e.g. by `newReceive()`, drops a waiting frame.
+
+	@param[in] data The frame (without frame check sequence), up to half of the transmit buffer.
+	@param[in] n The number of bytes.
+	@return `false` if a frame is waiting already (try again from the sent handler) or too long.
+	*/
+	boolean      streamData(byte data[], uint16_t n);
+	void         getData(byte data[], uint16_t n);
+	void         getData(String& data);
+	uint16_t     getDataLength();
+	void         getTransmitTimestamp(DW1000Time& time);
+	void         getReceiveTimestamp(DW1000Time& time);
+	void         getSystemTimestamp(DW1000Time& time);
+	void         getTransmitTimestamp(byte data[]);
+	void         getReceiveTimestamp(byte data[]);
+	void         getSystemTimestamp(byte data[]);
 
 	/* receive quality information. */
-	static float getReceivePower();
-	static float getFirstPathPower();
-	static float getReceiveQuality();
+	float getReceivePower();
+	float getFirstPathPower();
+	float getReceiveQuality();
+
+	/**
+	Receive metadata of the last good frame. It is read with one SPI transaction (RX_FINFO, RX_TIME and
+	RX_FQUAL) when the interrupt handler or `poll()` sees the frame complete, or on first use otherwise,
+	and stays valid until the next frame or `newReceive()`; while `process()` dispatches a deferred
+	event, the one taken with that frame. `getDataLength()`, `getReceiveTimestamp()` and the receive quality getters above
+	compute from it without further SPI access.
+	*/
+	struct RxFrameInfo {
+		uint16_t length;                   // RXFLEN, including the FCS bytes (RX_FINFO)
+		uint16_t preambleAccumulation;     // RXPACC (RX_FINFO)
+		byte     timestamp[LEN_RX_STAMP];  // RX_STAMP, not corrected for range bias (RX_TIME)
+		uint16_t firstPathIndex;           // FP_INDEX (RX_TIME)
+		uint16_t firstPathAmplitude1;      // FP_AMPL1 (RX_TIME)
+		uint16_t noise;                    // STD_NOISE (RX_FQUAL)
+		uint16_t firstPathAmplitude2;      // FP_AMPL2 (RX_FQUAL)
+		uint16_t firstPathAmplitude3;      // FP_AMPL3 (RX_FQUAL)
+		uint16_t channelImpulsePower;      // CIR_PWR (RX_FQUAL)
+	};
+	const RxFrameInfo& getRxFrameInfo();
 
 	/* Message Timings */
-	static volatile uint32_t _rxFrameTime;
-	static volatile uint32_t _txFrameTime;
+	volatile uint32_t _rxFrameTime;
+	volatile uint32_t _txFrameTime;
 
 	/* Get Message Timing Data */
-	static uint32_t getRxTime() {uint32_t ret = _rxFrameTime; _rxFrameTime = 0; return ret; }
-	static uint32_t getTxTime() {uint32_t ret = _txFrameTime; _txFrameTime = 0; return ret; }
+	uint32_t getRxTime() {uint32_t ret = _rxFrameTime; _rxFrameTime = 0; return ret; }
+	uint32_t getTxTime() {uint32_t ret = _txFrameTime; _txFrameTime = 0; return ret; }
 
 	/* interrupt management. */
-	static void interruptOnSent(boolean val);
-	static void interruptOnReceived(boolean val);
-	static void interruptOnReceiveFailed(boolean val);
-	static void interruptOnReceiveTimeout(boolean val);
-	static void interruptOnReceiveTimestampAvailable(boolean val);
-	static void interruptOnAutomaticAcknowledgeTrigger(boolean val);
-
-	static void interruptOnRxPreambleDetect(boolean val);
-	static void interruptOnRxFrameStart(boolean val);
-	static void interruptOnTxPreambleSent(boolean val);
-	static void interruptOnTxFrameStart(boolean val);
-	static void interruptOnAutomaticFrameFilteringrejection(boolean val);
+	void interruptOnSent(boolean val);
+	void interruptOnReceived(boolean val);
+	void interruptOnReceiveFailed(boolean val);
+	void interruptOnReceiveTimeout(boolean val);
+	void interruptOnReceiveTimestampAvailable(boolean val);
+	void interruptOnAutomaticAcknowledgeTrigger(boolean val);
+
+	void interruptOnRxPreambleDetect(boolean val);
+	void interruptOnRxFrameStart(boolean val);
+	void interruptOnTxPreambleSent(boolean val);
+	void interruptOnTxFrameStart(boolean val);
+	void interruptOnAutomaticFrameFilteringrejection(boolean val);
 
 	/* callback handler management. */
-	static void attachErrorHandler(void (* handleError)(void)) {
+	void attachErrorHandler(void (* handleError)(void)) {
 		_handleError = handleError;
 	}
 
-	static void attachSentHandler(void (* handleSent)(void)) {
+	void attachSentHandler(void (* handleSent)(void)) {
 		_handleSent = handleSent;
 	}
 
-	static void attachReceivedHandler(void (* handleReceived)(void)) {
+	void attachReceivedHandler(void (* handleReceived)(void)) {
 		_handleReceived = handleReceived;
 	}
 
-	static void attachReceiveFailedHandler(void (* handleReceiveFailed)(void)) {
+	void attachReceiveFailedHandler(void (* handleReceiveFailed)(void)) {
 		_handleReceiveFailed = handleReceiveFailed;
 	}
 
-	static void attachReceiveTimeoutHandler(void (* handleReceiveTimeout)(void)) {
+	void attachReceiveTimeoutHandler(void (* handleReceiveTimeout)(void)) {
 		_handleReceiveTimeout = handleReceiveTimeout;
 	}
 
-	static void attachReceiveTimestampAvailableHandler(void (* handleReceiveTimestampAvailable)(void)) {
+	void attachReceiveTimestampAvailableHandler(void (* handleReceiveTimestampAvailable)(void)) {
 		_handleReceiveTimestampAvailable = handleReceiveTimestampAvailable;
 	}
 
+	/**
+	Switches between handling interrupts completely in the interrupt handler (default) and deferred
+	processing. Deferred, the interrupt handler only reads and acknowledges the event status and queues
+	it together with its `micros()` time and, for a received frame, its metadata (see `getRxFrameInfo()`,
+	and DW1000_EVENT_RX_TIMESTAMP for the timestamp of other events); callbacks are run and the receiver
+	is restarted (see `receivePermanently()`) by `process()` from the main loop.
+
+	@param[in] val `true` to queue events for `process()`, `false` to handle them in the interrupt handler.
+	*/
+	void useDeferredInterrupts(boolean val);
+
+	/**
+	Runs the callbacks of queued events (see `useDeferredInterrupts()`) in the order they occurred.
+	`getRxTime()`/`getTxTime()`, the metadata of a received frame (`getRxFrameInfo()` and what is
+	computed from it: `getDataLength()`, `getReceiveTimestamp()`, the receive quality getters) and, if
+	captured, the RX timestamp of other events report the values of the event being dispatched. The
+	frame data (`getData()`) is read from the receive buffer though: it is the one of the event only if no
+	later frame was received meanwhile, e.g. with the buffer held in double-buffered mode.
+
+	@param[in] maxEvents Maximum number of events handled by this call, e.g. 1 to see each one in turn.
+
+	@return The number of events handled.
+	*/
+	uint8_t process(uint8_t maxEvents = 0xff);
+
+	/**
+	Number of events lost because the queue was full when the interrupt came in (see DW1000_EVENT_RING_SIZE).
+	*/
+	uint16_t getDroppedEventCount() { return _droppedEvents; }
+
 	/* device state management. */
 	// idle state
-	static void idle();
+	void idle();
 
 	// general configuration state
-	static void newConfiguration();
-	static void commitConfiguration();
+	void newConfiguration();
+	void commitConfiguration();
+	/**
+	Forgets which configuration the chip currently holds, so that the next `newConfiguration()` reads
+	back and the next `commitConfiguration()` writes (and tunes) everything again. Only needed if the
+	chip was reconfigured or reset behind the back of the driver.
+	*/
+	void invalidateConfiguration();
+	/**
+	Forgets all register shadows, i.e. configuration as well as clock, power management, LED, GPIO
+	mode and AON settings, as well as whether the transceiver is idle. Each register is read back from
+	the chip the next time it is modified. Only needed if the chip changed these registers itself or
+	was accessed by other code.
+	*/
+	void resyncRegisters();
 
-	// reception state
-	static void newReceive();
-	static void startReceive();
+	/**
+	Reception state. `newReceive()` turns the transceiver off and clears the receive status, both only
+	if needed: not after a frame, a timeout or a transmission that turned the chip idle by itself.
+	*/
+	void newReceive();
+	void startReceive();
+
+	/**
+	Transmission state. `newTransmit()` turns the transceiver off if needed (see `newReceive()`) and
+	clears the transmit status unless the sent event of the last frame did. `startTransmit()` turns the
+	receiver on after the frame only if asked for with `waitForResponse()` or, by a second SYS_CTRL write,
+	in permanent receive mode.
 
-	// transmission state
-	static void newTransmit();
-	static void startTransmit();
+	With `TX_THEN_RX` the receiver is turned on right after the frame in any case, by the chip with the
+	same SYS_CTRL write (WAIT4RESP) while the turnaround last written by `setResponseDelay()` is 0, as
+	if started by `startReceive()` otherwise.
+
+	@param[in] mode `TX_ONLY` or `TX_THEN_RX`.
+	*/
+	void newTransmit();
+	void startTransmit(byte mode = TX_ONLY);
 
 	/* ##### Operation mode selection ############################################ */
 	/**
@@ -383,13 +728,13 @@ public:
 
 	@param[in] mode The mode of operation, encoded by the above defined constants.
 	*/
-	static void enableMode(const byte mode[]);
+	void enableMode(const byte mode[]);
 
 	// use RX/TX specific and general default settings
-	static void setDefaults();
+	void setDefaults();
 
 	/* debug pretty print registers. */
-	static void getPrettyBytes(byte cmd, uint16_t offset, char msgBuffer[], uint16_t n);
+	void getPrettyBytes(byte cmd, uint16_t offset, char msgBuffer[], uint16_t n);
 	static void getPrettyBytes(byte data[], char msgBuffer[], uint16_t n);
 	static void getPrettyHex(byte data[], char msgBuffer[], uint16_t n);
 	static void printPrettyHex(byte data[], uint16_t n, boolean = true);
@@ -400,10 +745,14 @@ public:
 	static void convertToByte(char string[], byte* eui_byte);
 
 	// host-initiated reading of temperature and battery voltage
-	static void getTempAndVbat(float& temp, float& vbat);
-	static void getTempAndVbatByte(byte& temp, byte& vbat);
+	void getTempAndVbat(float& temp, float& vbat);
+	void getTempAndVbatByte(byte& temp, byte& vbat);
 	static float convertTemp(byte temp_in);
 
+	// receiver after a transmission, see startTransmit()
+	static constexpr byte TX_ONLY    = 0x00;
+	static constexpr byte TX_THEN_RX = 0x01;
+
 	// transmission/reception bit rate
 	static constexpr byte TRX_RATE_110KBPS  = 0x00;
 	static constexpr byte TRX_RATE_850KBPS  = 0x01;
@@ -478,142 +827,255 @@ public:
 
 //private:
 	/* chip select, reset and interrupt pins. */
-	static uint8_t _ss;
-	static uint8_t _rst;
-	static uint8_t _irq;
+	uint8_t _ss;
+	uint8_t _rst;
+	uint8_t _irq;
 
 	/* callbacks. */
-	static void (* _handleError)(void);
-	static void (* _handleSent)(void);
-	static void (* _handleReceived)(void);
-	static void (* _handleReceiveFailed)(void);
-	static void (* _handleReceiveTimeout)(void);
-	static void (* _handleReceiveTimestampAvailable)(void);
+	void (* _handleError)(void);
+	void (* _handleSent)(void);
+	void (* _handleReceived)(void);
+	void (* _handleReceiveFailed)(void);
+	void (* _handleReceiveTimeout)(void);
+	void (* _handleReceiveTimestampAvailable)(void);
 
 	/* register caches. */
-	static byte _syscfg[LEN_SYS_CFG];
-	static byte _sysctrl[LEN_SYS_CTRL];
-	static byte _sysstatus[LEN_SYS_STATUS];
-	static byte _txfctrl[LEN_TX_FCTRL];
-	static byte _sysmask[LEN_SYS_MASK];
-	static byte _chanctrl[LEN_CHAN_CTRL];
+	byte _syscfg[LEN_SYS_CFG];
+	byte _sysctrl[LEN_SYS_CTRL];
+	byte _sysstatus[LEN_SYS_STATUS];
+	byte _txfctrl[LEN_TX_FCTRL];
+	byte _sysmask[LEN_SYS_MASK];
+	byte _chanctrl[LEN_CHAN_CTRL];
+
+	/* register shadows, i.e. the content last written to or read from the chip. */
+	byte _syscfgShadow[LEN_SYS_CFG];
+	byte _txfctrlShadow[LEN_TX_FCTRL];
+	byte _sysmaskShadow[LEN_SYS_MASK];
+	byte _chanctrlShadow[LEN_CHAN_CTRL];
+	byte _networkAndAddressShadow[LEN_PANADR];
+	// clock/power management, GPIO and always-on registers (shadow only, written through)
+	byte _pmscctrl0[LEN_PMSC_CTRL0];
+	byte _pmscctrl1[LEN_PMSC_CTRL1];
+	byte _pmscledc[LEN_PMSC_LEDC];
+	byte _gpiomode[LEN_GPIO_MODE];
+	byte _aonwcfg[LEN_AON_WCFG];
+	byte _aoncfg0[LEN_AON_CFG0];
+	byte _drxpretoc[LEN_DRX_PRETOC];
+	byte _rxsniff[LEN_RX_SNIFF];
+	byte _w4rtim[LEN_W4R_TIM];
+	byte _rxfwto[LEN_RX_FWTO];
+	// one SHADOW_* bit per register (set) that is known to be in sync with the chip
+	uint32_t _shadowValid;
+	// tuning parameters (channel, preamble code/length, PRF, data rate) and TX power the chip is tuned to
+	uint32_t _tuneKey;
+	uint32_t _tuneTxPower;
 
 	/* device status monitoring */
-	static byte _vmeas3v3;
-	static byte _tmeas23C;
+	byte _vmeas3v3;
+	byte _tmeas23C;
+	byte _xtalTrim;
 
 	/* PAN and short address. */
-	static byte _networkAndAddress[LEN_PANADR];
-	static byte _network[LEN_PAN_ID];
-	static byte _address[LEN_SHORT_ADDR];
+	byte _networkAndAddress[LEN_PANADR];
+	byte _network[LEN_PAN_ID];
+	byte _address[LEN_SHORT_ADDR];
 
 	/* internal helper that guide tuning the chip. */
-	static boolean    _smartPower;
-	static byte       _extendedFrameLength;
-	static byte       _preambleCode;
-	static byte       _channel;
-	static byte       _preambleLength;
-	static byte       _pulseFrequency;
-	static byte       _dataRate;
-	static byte       _pacSize;
-	static DW1000Time _antennaDelay;
+	boolean    _smartPower;
+	byte       _extendedFrameLength;
+	byte       _preambleCode;
+	byte       _channel;
+	byte       _preambleLength;
+	byte       _pulseFrequency;
+	byte       _dataRate;
+	byte       _pacSize;
+	DW1000Time _antennaDelay;
 
 	/* internal helper to remember how to properly act. */
-	static boolean _permanentReceive;
-	static boolean _frameCheck;
+	boolean _permanentReceive;
+	boolean _frameCheck;
 
 	// whether RX or TX is active
-	static uint8_t _deviceMode;
+	uint8_t _deviceMode;
 
 	// antenna delay correction value
-	static int32_t _antennaDelayValue;
+	int32_t _antennaDelayValue;
 
 	// manual power setting
-	static int32_t _manualPowerSetting;
+	int32_t _manualPowerSetting;
 
 	// whether debounce clock is active
-	static boolean _debounceClockEnabled;
+	boolean _debounceClockEnabled;
 
 	/* Arduino interrupt handler */
-	static void handleInterrupt();
-
-	/* Allow MAC frame filtering . */
-	// TODO auto-acknowledge
-	static void setFrameFilter(boolean val);
-	static void setFrameFilterBehaveCoordinator(boolean val);
-	static void setFrameFilterAllowBeacon(boolean val);
-	//data type is used in the FC_1 0x41
-	static void setFrameFilterAllowData(boolean val);
-	static void setFrameFilterAllowAcknowledgement(boolean val);
-	static void setFrameFilterAllowMAC(boolean val);
-	//Reserved is used for the Blink message
-	static void setFrameFilterAllowReserved(boolean val);
-	static void setFrameFilterAllowType4(boolean val);
-	static void setFrameFilterAllowType5(boolean val);
-
-	// note: not sure if going to be implemented for now
-	static void setDoubleBuffering(boolean val);
-	// TODO is implemented, but needs testing
-	static void useExtendedFrameLength(boolean val);
+	void handleInterrupt();
+
+	/**
+	Interrupt event queued for `process()` (see `useDeferredInterrupts()`).
+	*/
+	struct Event {
+		uint32_t status; // SYS_STATUS, lower 32 bit
+		uint32_t time;   // micros() when the interrupt was handled
+		RxFrameInfo rxInfo; // metadata of the frame, if RXFCG is set in status
+#if DW1000_EVENT_RX_TIMESTAMP
+		byte rxStamp[LEN_RX_STAMP]; // RX_TIME, if LDEDONE but not RXFCG is set in status
+#endif
+	};
+
+	/* deferred interrupt processing: single producer (interrupt handler), single consumer (process()) ring. */
+	boolean _deferredInterrupts;
+	Event _events[DW1000_EVENT_RING_SIZE];
+	volatile uint8_t _eventHead;
+	volatile uint8_t _eventTail;
+	uint16_t _droppedEvents;
+	// captured RX timestamp of the event being dispatched, if any
+	const byte* _eventRxStamp;
+	void handleEvent(uint32_t now);
+	void handleStatus(uint32_t now);
+
+	/* double receive buffer: frames reported but not handed back to the chip, overruns. */
+	boolean _doubleBuffered;
+	volatile uint8_t _rxBuffersHeld;
+	uint16_t _rxOverruns;
+	void releaseReceiveBuffer();
+	void syncReceiveBuffers();
+	void resetReceiver();
+
+	/* receive metadata snapshot (see getRxFrameInfo()). */
+	RxFrameInfo _rxInfo;
+	boolean _rxInfoValid;
+	void readRxFrameInfo();
+	void dispatchEvent(const Event& event);
+	// receiver on again (permanent receive) after the chip turned it off
+	void restartReceive();
+	// interrupt line still asserted after this many events in a row is left to the next edge
+	static const uint8_t IRQ_MAX_ROUNDS = 4;
+
+	/* polled operation without interrupt line (see poll()). */
+	uint16_t _pollMin;
+	uint16_t _pollMax;
+	uint16_t _pollInterval;
+	uint32_t _lastPoll;
+	// a transmission is started but not reported sent yet, or a frame is being received
+	boolean _txPending;
+	boolean _rxPending;
+	// the chip acknowledges a received frame (auto-acknowledge), its sent event is not reported
+	boolean _ackPending;
+	// the transceiver turned itself off (see handleStatus()), and no receive status bits are latched
+	// since, i.e. newTransmit() and newReceive() need not turn it off or clear the status
+	boolean _trxOff;
+	boolean _rxStatusClean;
+	void idleIfActive();
+
+	/* streaming transmit: transmit buffer half written last, length of the frame waiting in it (0 for none). */
+	uint8_t  _streamHalf;
+	uint16_t _streamWaiting;
+	void startStreamed();
+
+	/* instances with an attached interrupt line, dispatched through one trampoline per slot. */
+	static DW1000Class* _instances[DW1000_MAX_INSTANCES];
+	static void (* const _isr[DW1000_MAX_INSTANCES])(void);
+	template<uint8_t slot> static void isr() { serviceInterrupt(slot); }
+	static void serviceInterrupt(uint8_t slot);
+
+	/* SPI bus ownership shared by all instances: nesting depth of the owners and, per slot, whether
+	 * an interrupt waits for the bus to be released. Both are changed within DW1000Hal::enterCritical(),
+	 * the interrupt handler may run on another core (ESP32) or thread (POSIX HAL). */
+	static volatile uint8_t _busOwners;
+	static volatile boolean _irqPending[DW1000_MAX_INSTANCES];
+	static boolean isInterruptPending();
+
 	// TODO is implemented, but needs testing
-	static void waitForResponse(boolean val);
+	void useExtendedFrameLength(boolean val);
+
+	/* tuning according to mode, does nothing if the chip is tuned to the current mode already. */
+	void tune();
 
-	/* tuning according to mode. */
-	static void tune();
+	/* preamble length of the configuration in symbols. */
+	uint16_t preambleSymbols();
 
 	/* device status flags */
-	static boolean isReceiveTimestampAvailable();
-	static boolean isTransmitDone();
+	boolean isReceiveTimestampAvailable();
+	boolean isTransmitDone();
 
-	static boolean isRxPreambleDetected();
-	static boolean startOfRxFrame();
-	static boolean isTxPreambleSent();
-	static boolean isTxFrameSent();
+	boolean isRxPreambleDetected();
+	boolean startOfRxFrame();
+	boolean isTxPreambleSent();
+	boolean isTxFrameSent();
 
-	static boolean isLate();
-	static boolean isReceiveDone();
-	static boolean isReceiveFailed();
-	static boolean isReceiveTimeout();
-	static boolean isClockProblem();
+	boolean isLate();
+	boolean isReceiveDone();
+	boolean isReceiveFailed();
+	boolean isReceiveTimeout();
+	boolean isClockProblem();
 
 	/* interrupt state handling */
-	static void clearInterrupts();
-	static void clearAllStatus();
-	static void clearReceiveStatus();
-	static void clearReceiveTimestampAvailableStatus();
-	static void clearTransmitStatus();
+	void clearInterrupts();
+	void clearAllStatus();
+	void clearReceiveStatus();
+	void clearReceiveTimestampAvailableStatus();
+	void clearTransmitStatus();
 
 	/* internal helper to read/write system registers. */
-	static void readSystemEventStatusRegister();
-	static void readSystemConfigurationRegister();
-	static void writeSystemConfigurationRegister();
-	static void readNetworkId();
-	static void	readDeviceAddress();
-	static void writeNetworkId();
-	static void	writeDeviceAddress();
-	static void readNetworkIdAndDeviceAddress();
-	static void writeNetworkIdAndDeviceAddress();
-	static void readSystemEventMaskRegister();
-	static void writeSystemEventMaskRegister();
-	static void readChannelControlRegister();
-	static void writeChannelControlRegister();
-	static void readTransmitFrameControlRegister();
-	static void writeTransmitFrameControlRegister();
+	void readSystemEventStatusRegister();
+	void readSystemConfigurationRegister();
+	void writeSystemConfigurationRegister();
+	void readNetworkId();
+	void	readDeviceAddress();
+	void writeNetworkId();
+	void	writeDeviceAddress();
+	void readNetworkIdAndDeviceAddress();
+	void writeNetworkIdAndDeviceAddress();
+	void readSystemEventMaskRegister();
+	void writeSystemEventMaskRegister();
+	void readChannelControlRegister();
+	void writeChannelControlRegister();
+	void readTransmitFrameControlRegister();
+	void writeTransmitFrameControlRegister();
+
+	/* internal helper to keep register caches and shadows in sync with the chip. */
+	void readShadowed(byte reg, byte image[], byte shadow[], uint16_t n, uint32_t flag);
+	void writeShadowed(byte reg, byte image[], byte shadow[], uint16_t n, uint32_t flag);
+	void loadShadowed(byte reg, byte image[], byte shadow[], uint16_t n, uint32_t flag);
+	void commitShadowed(byte reg, byte image[], byte shadow[], uint16_t n, uint32_t flag);
+	void fetchShadow(byte reg, uint16_t offset, byte shadow[], uint16_t n, uint32_t flag);
+	void invalidateShadow(uint32_t flags);
 
 	/* clock management. */
-	static void enableClock(byte clock);
+	void enableClock(byte clock);
 
 	/* LDE micro-code management. */
-	static void manageLDE();
+	void manageLDE();
 
 	/* timestamp correction. */
-	static void correctTimestamp(DW1000Time& timestamp);
+	void correctTimestamp(DW1000Time& timestamp);
 
 	/* reading and writing bytes from and to DW1000 module. */
-	static void readBytes(byte cmd, uint16_t offset, byte data[], uint16_t n);
-	static void readBytesOTP(uint16_t address, byte data[]);
-	static void writeByte(byte cmd, uint16_t offset, byte data);
-	static void writeBytes(byte cmd, uint16_t offset, byte data[], uint16_t n);
+	void readBytes(byte cmd, uint16_t offset, byte data[], uint16_t n);
+	void readBytesOTP(uint16_t address, byte data[]);
+	void writeByte(byte cmd, uint16_t offset, byte data);
+	void writeBytes(byte cmd, uint16_t offset, byte data[], uint16_t n);
+
+	/**
+	One register access of a batch (see `transfer()`).
+	*/
+	struct RegisterAccess {
+		byte     cmd;    // register file
+		uint16_t offset; // sub-address or NO_SUB
+		byte*    data;   // bytes to be written or buffer to be read into
+		uint16_t n;      // number of bytes
+		boolean  write;  // write or read access
+	};
+
+	/* batch of register accesses within one SPI transaction, adjacent accesses merged into one burst. */
+	void transfer(const RegisterAccess accesses[], uint8_t count);
+
+	/* SPI framing and payload transfer of the currently selected chip. */
+	void spiHeader(boolean write, byte cmd, uint16_t offset);
+	void spiSelect();
+	void spiDeselect();
+	void spiRead(byte data[], uint16_t n);
+	void spiWrite(const byte data[], uint16_t n);
 
 	/* writing numeric values to bytes. */
 	static void writeValueToBytes(byte data[], int32_t val, uint16_t n);
@@ -630,15 +1092,44 @@ public:
 	static const byte READ_SUB   = 0x40; // read with sub address
 	static const byte RW_SUB_EXT = 0x80; // R/W with sub address extension
 
+	/* shadowed registers/register sets (see _shadowValid). */
+	static const uint32_t SHADOW_PANADR     = 0x00000001;
+	static const uint32_t SHADOW_SYS_CFG    = 0x00000002;
+	static const uint32_t SHADOW_CHAN_CTRL  = 0x00000004;
+	static const uint32_t SHADOW_TX_FCTRL   = 0x00000008;
+	static const uint32_t SHADOW_SYS_MASK   = 0x00000010;
+	static const uint32_t SHADOW_TUNE       = 0x00000020; // all registers written by tune()
+	static const uint32_t SHADOW_ANTD       = 0x00000040; // TX and RX antenna delay
+	static const uint32_t SHADOW_CONFIG     = 0x0000007F;
+	static const uint32_t SHADOW_PMSC_CTRL0 = 0x00000080;
+	static const uint32_t SHADOW_PMSC_CTRL1 = 0x00000100;
+	static const uint32_t SHADOW_PMSC_LEDC  = 0x00000200;
+	static const uint32_t SHADOW_GPIO_MODE  = 0x00000400;
+	static const uint32_t SHADOW_AON_WCFG   = 0x00000800;
+	static const uint32_t SHADOW_AON_CFG0   = 0x00001000;
+	static const uint32_t SHADOW_DRX_PRETOC = 0x00002000;
+	static const uint32_t SHADOW_RX_SNIFF   = 0x00004000;
+	static const uint32_t SHADOW_ACK_RESP_T = 0x00008000; // W4R_TIM only
+	static const uint32_t SHADOW_RX_FWTO    = 0x00010000;
+	static const uint32_t SHADOW_ALL        = 0x0001FFFF;
+
 	/* clocks available. */
 	static const byte AUTO_CLOCK = 0x00;
 	static const byte XTI_CLOCK  = 0x01;
 	static const byte PLL_CLOCK  = 0x02;
 
 	/* SPI configs. */
-	static const SPISettings _fastSPI;
-	static const SPISettings _slowSPI;
-	static const SPISettings* _currentSPI;
+	static const DW1000Hal::SpiSettings _fastSPI;
+	static const DW1000Hal::SpiSettings _slowSPI;
+	const DW1000Hal::SpiSettings* _currentSPI;
+
+	/* chip select hold times [us] for fast and slow SPI. */
+	uint8_t _csHoldFast;
+	uint8_t _csHoldSlow;
+
+	/* SPI statistics (see DW1000_SPI_STATS). */
+	volatile uint32_t _spiTransactions;
+	volatile uint32_t _spiBytes;
 
 	/* range bias tables (500/900 MHz band, 16/64 MHz PRF), -61 to -95 dBm. */
 	static const byte BIAS_500_16_ZERO = 10;
@@ -30,4 +30,76 @@
  */
 #define DW1000TIME_H_PRINTABLE true
 
+/**
+ * Transfer register payloads as whole buffers instead of one SPI.transfer(byte) call per byte.
+ * Uses SPI.transfer(buffer, n) (pipelined on AVR, DMA-capable on some ARM cores) and
+ * SPI.writeBytes() on ESP8266/ESP32. Costs DW1000_SPI_CHUNK bytes of stack while writing.
+ * Set false if the SPI library of your core has no buffer transfer, the byte loop is used then
+ */
+#define DW1000_SPI_BURST true
+
+/**
+ * Size of the stack buffer used to write payloads in bursts on cores that only offer an
+ * in-place buffer transfer (the payload of the caller must not be overwritten by read back data)
+ */
+#define DW1000_SPI_CHUNK 32
+
+/**
+ * Chip select hold time [us] between the last SPI byte and raising SS, separately for the fast SPI
+ * clock (normal operation) and the slow one (XTI clock during init/LDE load).
+ * The DW1000 only needs some ns here (see data sheet SPI timing), so nothing is waited at fast SPI.
+ * Raise it for boards with slow SS lines (long wires, level shifters); see also setChipSelectHoldTime()
+ */
+#define DW1000_CS_HOLD_FAST_US 0
+#define DW1000_CS_HOLD_SLOW_US 5
+
+/**
+ * Count SPI transactions and payload bytes to the DW1000 (see getSpiTransactionCount()).
+ * Costs 8 byte ram and some cycles per register access, useful for benchmarks only
+ */
+#define DW1000_SPI_STATS false
+
+/**
+ * Also register the DW1000 interrupt with SPI.usingInterrupt(), i.e. mask it during SPI transactions of
+ * other devices on the same bus. The driver does not need it for itself, as interrupts are deferred
+ * while it uses the bus (see DW1000Class::acquireBus()); not supported by every core, e.g. ESP8266
+ */
+#define DW1000_SPI_USING_INTERRUPT false
+
+/**
+ * Default bounds [us] of the adaptive interval at which DW1000Class::poll() reads the status when no
+ * interrupt line is wired: the minimum while a transmission or reception is in progress, backing off
+ * up to the maximum while nothing happens; see also setPollInterval()
+ */
+#define DW1000_POLL_MIN_US 100
+#define DW1000_POLL_MAX_US 10000
+
+/**
+ * Number of events the interrupt handler can queue per instance for process() in deferred mode (see
+ * DW1000Class::useDeferredInterrupts()), a power of two up to 128. Costs about 30 byte ram per event (status,
+ * time and the metadata of a received frame)
+ */
+#define DW1000_EVENT_RING_SIZE 4
+
+/**
+ * Also capture the RX timestamp of events without a received frame (e.g. a failed frame) in the
+ * interrupt handler in deferred mode, so it is still valid when process() runs; received frames carry it
+ * in their metadata anyway. Costs 5 byte ram per event and one SPI transaction per such event
+ */
+#define DW1000_EVENT_RX_TIMESTAMP false
+
+#if DW1000_EVENT_RING_SIZE < 1 || DW1000_EVENT_RING_SIZE > 128 || (DW1000_EVENT_RING_SIZE & (DW1000_EVENT_RING_SIZE - 1)) != 0
+#error "DW1000_EVENT_RING_SIZE must be a power of two up to 128"
+#endif
+
+/**
+ * Number of DW1000Class instances (i.e. chips with their own interrupt line) that can be begun at the
+ * same time, at most 4. Each costs a pointer of ram and an interrupt trampoline in flash
+ */
+#define DW1000_MAX_INSTANCES 2
+
+#if DW1000_MAX_INSTANCES < 1 || DW1000_MAX_INSTANCES > 4
+#error "DW1000_MAX_INSTANCES must be 1 to 4"
+#endif
+
 #endif // DW1000COMPILEOPTIONS_H
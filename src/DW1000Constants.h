@@ -46,7 +46,7 @@
 // PAN identifier, short address register
 #define PANADR 0x03
 #define LEN_PANADR 4
-#define PAN_ID 15
+#define PAN_ID 2
 #define LEN_PAN_ID 2
 #define SHORT_ADDR 0
 #define LEN_SHORT_ADDR 2
@@ -68,6 +68,7 @@
 #define HIRQ_POL_BIT 9
 #define RXWTOE_BIT 28
 #define RXAUTR_BIT 29
+#define AUTOACK_BIT 30
 #define PHR_MODE_SUB 16
 #define LEN_PHR_MODE_SUB 2
 #define RXM110K_BIT 22
@@ -83,6 +84,7 @@
 #define WAIT4RESP_BIT 7
 #define RXENAB_BIT 8
 #define RXDLYS_BIT 9
+#define HRBPT_BIT 24
 
 // system event status register
 #define SYS_STATUS 0x0F
@@ -105,6 +107,7 @@
 #define RXRFSL_BIT 16
 #define RXRFTO_BIT 17
 #define LDEERR_BIT 18
+#define RXOVRR_BIT 20
 #define RXPTO_BIT 21
 #define SLP2INIT_BIT 23
 #define RFPLL_LL_BIT 24
@@ -112,6 +115,8 @@
 #define RXSFDTO_BIT 26
 #define HPDWARN 27
 #define AFFREJ_BIT 29
+#define HSRBP_BIT 30
+#define ICRBP_BIT 31
 #define RXPREJ_BIT 33
 
 // system event mask register
@@ -157,6 +162,18 @@
 #define RX_FWTO 0x0C
 #define LEN_RX_FWTO 2
 
+// preamble sniff mode
+#define RX_SNIFF 0x1D
+#define LEN_RX_SNIFF 4
+
+// acknowledgement time and response time
+#define ACK_RESP_T 0x1A
+#define LEN_ACK_RESP_T 4
+#define W4R_TIM_SUB 0
+#define LEN_W4R_TIM 3
+#define ACK_TIM_SUB 3
+#define LEN_ACK_TIM 1
+
 // transmit data buffer
 #define TX_BUFFER 0x09
 #define LEN_TX_BUFFER 1024
@@ -174,6 +191,7 @@
 // transmit control
 #define TX_FCTRL 0x08
 #define LEN_TX_FCTRL 5
+#define TXBOFFS_BIT 22
 
 // channel control
 #define CHAN_CTRL 0x1F
@@ -219,6 +237,10 @@
 #define LEN_DRX_TUNE2 4
 #define LEN_DRX_TUNE4H 2
 
+// DRX_PRETOC (preamble detection timeout, in the DRX_CONF register file)
+#define DRX_PRETOC_SUB 0x24
+#define LEN_DRX_PRETOC 2
+
 // LDE_CFG1 (for re-tuning only)
 #define LDE_IF 0x2E
 #define LDE_CFG1_SUB 0x0806
@@ -284,8 +306,12 @@
 #define LEN_PMSC_CTRL0 4
 #define LEN_PMSC_CTRL1 4
 #define LEN_PMSC_LEDC 4
+#define PMSC_SOFTRESET_SUB 0x03
+#define SOFTRESET_RX 0xE0
+#define SOFTRESET_CLEAR 0xF0
 #define GPDCE_BIT 18
 #define KHZCLKEN_BIT 23
+#define PLL2_SEQ_EN_BIT 24
 #define BLNKEN 8
 
 #define ATXSLP_BIT 11
@@ -129,14 +129,14 @@ void DW1000Device::randomShortAddress() {
 }
 
 void DW1000Device::noteActivity() {
-	_activity = millis();
+	_activity = DW1000Hal::millis();
 }
 
 
 boolean DW1000Device::isInactive() {
 	//One second of inactivity
-	if(millis()-_activity > INACTIVITY_TIME) {
-		_activity = millis();
+	if(DW1000Hal::millis()-_activity > INACTIVITY_TIME) {
+		_activity = DW1000Hal::millis();
 		return true;
 	}
 	return false;
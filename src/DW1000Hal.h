@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000Hal.h
+ * Compile-time hardware abstraction of the driver: SPI, GPIO, interrupt and time.
+ *
+ * The driver only talks to the hardware through `DW1000Hal`, a struct of static
+ * functions selected with DW1000_HAL (e.g. -DDW1000_HAL=DW1000_HAL_SIM):
+ * - DW1000_HAL_ARDUINO (default): Arduino core and SPI library, all inline
+ * - DW1000_HAL_POSIX: Linux spidev, sysfs GPIO and clock_gettime()
+ * - DW1000_HAL_SIM: in-memory DW1000 model with virtual time, for host tests and benchmarks
+ *
+ * A HAL provides:
+ * - SpiSettings spiSettings(uint32_t clock)
+ * - void spiBegin(uint8_t irq), spiEnd()
+ * - void spiBeginTransaction(const SpiSettings& settings), spiEndTransaction()
+ * - void spiRead(byte data[], uint16_t n), spiWrite(const byte data[], uint16_t n)
+ * - void pinMode(uint8_t pin, uint8_t mode), digitalWrite(uint8_t pin, uint8_t val)
+ * - uint8_t digitalRead(uint8_t pin) (also for the interrupt line)
+ * - boolean attachInterrupt(uint8_t pin, void (*isr)(void)) (rising edge, false if the line cannot be watched)
+ * - void enterCritical(), exitCritical() (short section excluding the interrupt handler, also called from it)
+ * - void delay(uint32_t ms), delayMicroseconds(uint32_t us)
+ * - uint32_t millis(), micros()
+ */
+
+#ifndef _DW1000HAL_H_INCLUDED
+#define _DW1000HAL_H_INCLUDED
+
+#define DW1000_HAL_ARDUINO 0
+#define DW1000_HAL_POSIX   1
+#define DW1000_HAL_SIM     2
+
+#ifndef DW1000_HAL
+#define DW1000_HAL DW1000_HAL_ARDUINO
+#endif
+
+#if DW1000_HAL == DW1000_HAL_ARDUINO
+#include "DW1000HalArduino.h"
+typedef DW1000HalArduino DW1000Hal;
+#elif DW1000_HAL == DW1000_HAL_POSIX
+#include "DW1000HalPosix.h"
+typedef DW1000HalPosix DW1000Hal;
+#elif DW1000_HAL == DW1000_HAL_SIM
+#include "DW1000HalSim.h"
+typedef DW1000HalSim DW1000Hal;
+#else
+#error "Unknown DW1000_HAL, use DW1000_HAL_ARDUINO, DW1000_HAL_POSIX or DW1000_HAL_SIM"
+#endif
+
+#endif
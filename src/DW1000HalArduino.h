@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000HalArduino.h
+ * Arduino implementation of the hardware abstraction (see DW1000Hal.h).
+ * Everything is inline and maps 1:1 to the Arduino core and SPI library.
+ */
+
+#ifndef _DW1000HALARDUINO_H_INCLUDED
+#define _DW1000HALARDUINO_H_INCLUDED
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "DW1000CompileOptions.h"
+#include "DW1000Constants.h"
+
+struct DW1000HalArduino {
+	typedef SPISettings SpiSettings;
+
+	static inline SpiSettings spiSettings(uint32_t clock) {
+		return SPISettings(clock, MSBFIRST, SPI_MODE0);
+	}
+
+	static inline void spiBegin(uint8_t irq) {
+		SPI.begin();
+#if DW1000_SPI_USING_INTERRUPT && !defined(ESP8266)
+		if (irq != 0xff) {
+			SPI.usingInterrupt(digitalPinToInterrupt(irq)); // not every board support this, e.g. ESP8266
+		}
+#endif
+	}
+
+	static inline void spiEnd() {
+		SPI.end();
+	}
+
+	static inline void spiBeginTransaction(const SpiSettings& settings) {
+		SPI.beginTransaction(settings);
+	}
+
+	static inline void spiEndTransaction() {
+		SPI.endTransaction();
+	}
+
+	/* clock n bytes in (chip select already low). */
+	static inline void spiRead(byte data[], uint16_t n) {
+#if DW1000_SPI_BURST
+		// the buffer is sent and overwritten in place with what is read back
+		memset(data, JUNK, n);
+		SPI.transfer(data, n);
+#else
+		for (uint16_t i = 0; i < n; i++) {
+			data[i] = SPI.transfer(JUNK);
+		}
+#endif
+	}
+
+	/* clock n bytes out (chip select already low), read back data is discarded. */
+	static inline void spiWrite(const byte data[], uint16_t n) {
+#if DW1000_SPI_BURST && (defined(ESP8266) || defined(ESP32))
+		SPI.writeBytes(data, n);
+#elif DW1000_SPI_BURST
+		// in-place transfer only, so send a copy to keep the data (e.g. register caches) of the caller
+		byte chunk[DW1000_SPI_CHUNK];
+		while (n > 0) {
+			uint16_t len = (n < DW1000_SPI_CHUNK ? n : DW1000_SPI_CHUNK);
+			memcpy(chunk, data, len);
+			SPI.transfer(chunk, len);
+			data += len;
+			n -= len;
+		}
+#else
+		for (uint16_t i = 0; i < n; i++) {
+			SPI.transfer(data[i]);
+		}
+#endif
+	}
+
+	static inline void pinMode(uint8_t pin, uint8_t mode) {
+		::pinMode(pin, mode);
+	}
+
+	static inline void digitalWrite(uint8_t pin, uint8_t val) {
+		::digitalWrite(pin, val);
+	}
+
+	static inline uint8_t digitalRead(uint8_t pin) {
+		return ::digitalRead(pin);
+	}
+
+	static inline boolean attachInterrupt(uint8_t pin, void (* isr)(void)) {
+#ifdef NOT_AN_INTERRUPT
+		if(digitalPinToInterrupt(pin) == NOT_AN_INTERRUPT) {
+			return false;
+		}
+#endif
+		::attachInterrupt(digitalPinToInterrupt(pin), isr, RISING);
+		return true;
+	}
+
+#if defined(ESP32)
+	/* the interrupt handler may run on the other core, so take a spinlock. */
+	static inline portMUX_TYPE* criticalMux() {
+		static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+		return &mux;
+	}
+
+	static inline void enterCritical() {
+		portENTER_CRITICAL_SAFE(criticalMux());
+	}
+
+	static inline void exitCritical() {
+		portEXIT_CRITICAL_SAFE(criticalMux());
+	}
+#else
+	/* single core: the interrupt handler runs to completion and leaves the bus owner count as it found
+	 * it, so its read-modify-writes need no lock; the release of the bus is ordered so that an interrupt
+	 * in between either finds the bus free or its flag is seen afterwards (see DW1000Class::releaseBus()). */
+	static inline void enterCritical() {
+	}
+
+	static inline void exitCritical() {
+	}
+#endif
+
+	static inline void delay(uint32_t ms) {
+		::delay(ms);
+	}
+
+	static inline void delayMicroseconds(uint32_t us) {
+		::delayMicroseconds(us);
+	}
+
+	static inline uint32_t millis() {
+		return ::millis();
+	}
+
+	static inline uint32_t micros() {
+		return ::micros();
+	}
+};
+
+#endif
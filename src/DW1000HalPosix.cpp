@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000HalPosix.cpp
+ * Linux implementation of the hardware abstraction (see DW1000HalPosix.h).
+ */
+
+#include "DW1000Hal.h"
+
+#if DW1000_HAL == DW1000_HAL_POSIX
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+#include "DW1000CompileOptions.h"
+#include "DW1000Constants.h"
+
+static int _spi = -1;
+static uint32_t _spiClock = 0;
+static int _gpio[256];
+static boolean _gpioInit = false;
+static pthread_mutex_t _bus;
+static boolean _busInit = false;
+/* the interrupt threads run concurrently with the main program, not only on the bus. */
+static pthread_mutex_t _critical = PTHREAD_MUTEX_INITIALIZER;
+
+/* one thread per interrupt line, i.e. per driver instance. */
+struct IrqLine {
+	uint8_t pin;
+	int fd;
+	void (* isr)(void);
+	pthread_t thread;
+};
+static IrqLine _irqLines[DW1000_MAX_INSTANCES];
+static uint8_t _irqLineCount = 0;
+
+/* failures reported on stderr, each kind once: a line that fails does so on every access. */
+static boolean _reportedSpi = false;
+static boolean _reportedGpio = false;
+static boolean _reportedIrq = false;
+
+static void report(boolean& reported, const char* what) {
+	if(!reported) {
+		perror(what);
+		reported = true;
+	}
+}
+
+static void writeFile(const char* path, const char* value) {
+	int fd = open(path, O_WRONLY);
+	if(fd < 0) {
+		return;
+	}
+	// fails harmlessly e.g. if the pin is exported already
+	if(write(fd, value, strlen(value)) < 0) {
+	}
+	close(fd);
+}
+
+/* export pin and open its value file, returns the file descriptor. */
+static int gpio(uint8_t pin, const char* direction, const char* edge) {
+	char path[64];
+	char number[4];
+	if(!_gpioInit) {
+		for(uint16_t i = 0; i < 256; i++) {
+			_gpio[i] = -1;
+		}
+		_gpioInit = true;
+	}
+	snprintf(number, sizeof(number), "%u", pin);
+	if(_gpio[pin] < 0) {
+		writeFile(DW1000_POSIX_GPIO "/export", number);
+	}
+	snprintf(path, sizeof(path), DW1000_POSIX_GPIO "/gpio%u/direction", pin);
+	writeFile(path, direction);
+	snprintf(path, sizeof(path), DW1000_POSIX_GPIO "/gpio%u/edge", pin);
+	writeFile(path, edge);
+	if(_gpio[pin] < 0) {
+		snprintf(path, sizeof(path), DW1000_POSIX_GPIO "/gpio%u/value", pin);
+		_gpio[pin] = open(path, O_RDWR);
+		if(_gpio[pin] < 0) {
+			report(_reportedGpio, path);
+		}
+	}
+	return _gpio[pin];
+}
+
+static void spiTransfer(const byte tx[], byte rx[], uint16_t n) {
+	struct spi_ioc_transfer transfer;
+	if(_spi < 0 || n == 0) {
+		return;
+	}
+	memset(&transfer, 0, sizeof(transfer));
+	transfer.tx_buf        = (unsigned long)tx;
+	transfer.rx_buf        = (unsigned long)rx;
+	transfer.len           = n;
+	transfer.speed_hz      = _spiClock;
+	transfer.bits_per_word = 8;
+	if(ioctl(_spi, SPI_IOC_MESSAGE(1), &transfer) < 0) {
+		report(_reportedSpi, "DW1000: SPI transfer");
+	}
+}
+
+/* interrupt thread, the handler runs with the bus locked like an ISR. */
+static void* irqLoop(void* arg) {
+	IrqLine* line = (IrqLine*)arg;
+	int fd = line->fd;
+	char value[4];
+	struct pollfd pfd;
+	pfd.fd     = fd;
+	pfd.events = POLLPRI | POLLERR;
+	// consume the current state, then wait for edges
+	lseek(fd, 0, SEEK_SET);
+	if(read(fd, value, sizeof(value)) < 0) {
+		return 0;
+	}
+	while(poll(&pfd, 1, -1) >= 0) {
+		lseek(fd, 0, SEEK_SET);
+		if(read(fd, value, sizeof(value)) < 0) {
+			break;
+		}
+		pthread_mutex_lock(&_bus);
+		(*line->isr)();
+		pthread_mutex_unlock(&_bus);
+	}
+	return 0;
+}
+
+void DW1000HalPosix::spiBegin(uint8_t /* irq */) {
+	byte mode = SPI_MODE_0 | SPI_NO_CS;
+	byte bits = 8;
+	if(!_busInit) {
+		pthread_mutexattr_t attr;
+		pthread_mutexattr_init(&attr);
+		pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+		pthread_mutex_init(&_bus, &attr);
+		pthread_mutexattr_destroy(&attr);
+		_busInit = true;
+	}
+	if(_spi >= 0) {
+		return; // opened by another instance already
+	}
+	_spi = open(DW1000_POSIX_SPIDEV, O_RDWR);
+	if(_spi < 0) {
+		report(_reportedSpi, DW1000_POSIX_SPIDEV);
+		return;
+	}
+	if(ioctl(_spi, SPI_IOC_WR_MODE, &mode) < 0) {
+		// controller does not support SPI_NO_CS, chip select is driven as GPIO anyway
+		mode = SPI_MODE_0;
+		ioctl(_spi, SPI_IOC_WR_MODE, &mode);
+	}
+	ioctl(_spi, SPI_IOC_WR_BITS_PER_WORD, &bits);
+}
+
+void DW1000HalPosix::spiEnd() {
+	if(_spi >= 0) {
+		close(_spi);
+		_spi = -1;
+	}
+}
+
+void DW1000HalPosix::spiBeginTransaction(const SpiSettings& settings) {
+	pthread_mutex_lock(&_bus);
+	_spiClock = settings;
+}
+
+void DW1000HalPosix::spiEndTransaction() {
+	pthread_mutex_unlock(&_bus);
+}
+
+void DW1000HalPosix::spiRead(byte data[], uint16_t n) {
+	memset(data, JUNK, n);
+	spiTransfer(data, data, n);
+}
+
+void DW1000HalPosix::spiWrite(const byte data[], uint16_t n) {
+	spiTransfer(data, 0, n);
+}
+
+void DW1000HalPosix::pinMode(uint8_t pin, uint8_t mode) {
+	gpio(pin, mode == OUTPUT ? "out" : "in", "none");
+}
+
+void DW1000HalPosix::digitalWrite(uint8_t pin, uint8_t val) {
+	int fd = (_gpioInit && _gpio[pin] >= 0 ? _gpio[pin] : gpio(pin, "out", "none"));
+	if(fd >= 0 && write(fd, val == LOW ? "0" : "1", 1) < 0) {
+		// chip select or reset line stuck, every register access fails from here
+		report(_reportedGpio, "DW1000: GPIO write");
+	}
+}
+
+uint8_t DW1000HalPosix::digitalRead(uint8_t pin) {
+	char value;
+	int fd = (_gpioInit && _gpio[pin] >= 0 ? _gpio[pin] : gpio(pin, "in", "none"));
+	// pread, as the interrupt thread may wait on the same file
+	if(fd < 0 || pread(fd, &value, 1, 0) != 1) {
+		return LOW;
+	}
+	return (value == '1' ? HIGH : LOW);
+}
+
+boolean DW1000HalPosix::attachInterrupt(uint8_t pin, void (* isr)(void)) {
+	pthread_mutex_lock(&_bus);
+	for(uint8_t i = 0; i < _irqLineCount; i++) {
+		if(_irqLines[i].pin == pin) {
+			// line is watched already, e.g. begin() called again
+			_irqLines[i].isr = isr;
+			pthread_mutex_unlock(&_bus);
+			return true;
+		}
+	}
+	pthread_mutex_unlock(&_bus);
+	if(_irqLineCount >= DW1000_MAX_INSTANCES) {
+		errno = ENOSPC;
+		report(_reportedIrq, "DW1000: more interrupt lines than DW1000_MAX_INSTANCES");
+		return false;
+	}
+	IrqLine* line = &_irqLines[_irqLineCount];
+	line->pin = pin;
+	line->fd  = gpio(pin, "in", "rising");
+	line->isr = isr;
+	if(line->fd < 0) {
+		// reported by gpio()
+		return false;
+	}
+	int error = pthread_create(&line->thread, 0, irqLoop, line);
+	if(error != 0) {
+		errno = error;
+		report(_reportedIrq, "DW1000: interrupt thread");
+		return false;
+	}
+	_irqLineCount++;
+	return true;
+}
+
+void DW1000HalPosix::enterCritical() {
+	pthread_mutex_lock(&_critical);
+}
+
+void DW1000HalPosix::exitCritical() {
+	pthread_mutex_unlock(&_critical);
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000HalPosix.h
+ * Linux implementation of the hardware abstraction (see DW1000Hal.h), e.g. for a
+ * DW1000 wired to the SPI header of a Raspberry Pi.
+ *
+ * - SPI: spidev (DW1000_POSIX_SPIDEV), opened with SPI_NO_CS as chip select is
+ *   driven as GPIO by the driver, i.e. pass the GPIO number as `ss` to select()
+ * - GPIO: sysfs (DW1000_POSIX_GPIO), pins are GPIO numbers
+ * - interrupt: a thread waiting for rising edges of the IRQ GPIO, the handler is
+ *   serialized with SPI transactions of the other threads (as with SPI.usingInterrupt())
+ * - time: CLOCK_MONOTONIC
+ *
+ * Built with a host toolchain only, see extras/host.
+ */
+
+#ifndef _DW1000HALPOSIX_H_INCLUDED
+#define _DW1000HALPOSIX_H_INCLUDED
+
+#include <Arduino.h>
+#include <time.h>
+
+#ifndef DW1000_POSIX_SPIDEV
+#define DW1000_POSIX_SPIDEV "/dev/spidev0.0"
+#endif
+
+#ifndef DW1000_POSIX_GPIO
+#define DW1000_POSIX_GPIO "/sys/class/gpio"
+#endif
+
+struct DW1000HalPosix {
+	typedef uint32_t SpiSettings; // SPI clock [Hz]
+
+	static inline SpiSettings spiSettings(uint32_t clock) {
+		return clock;
+	}
+
+	static void spiBegin(uint8_t irq);
+	static void spiEnd();
+	static void spiBeginTransaction(const SpiSettings& settings);
+	static void spiEndTransaction();
+	static void spiRead(byte data[], uint16_t n);
+	static void spiWrite(const byte data[], uint16_t n);
+
+	static void pinMode(uint8_t pin, uint8_t mode);
+	static void digitalWrite(uint8_t pin, uint8_t val);
+	static uint8_t digitalRead(uint8_t pin);
+	static boolean attachInterrupt(uint8_t pin, void (* isr)(void));
+	static void enterCritical();
+	static void exitCritical();
+
+	static inline void delay(uint32_t ms) {
+		delayMicroseconds(ms * 1000UL);
+	}
+
+	static inline void delayMicroseconds(uint32_t us) {
+		struct timespec ts;
+		ts.tv_sec  = us / 1000000UL;
+		ts.tv_nsec = (us % 1000000UL) * 1000UL;
+		while (nanosleep(&ts, &ts) != 0) {
+		}
+	}
+
+	static inline uint32_t millis() {
+		return (uint32_t)(monotonicNanos() / 1000000ULL);
+	}
+
+	static inline uint32_t micros() {
+		return (uint32_t)(monotonicNanos() / 1000ULL);
+	}
+
+	static inline uint64_t monotonicNanos() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+	}
+};
+
+#endif
@@ -0,0 +1,1006 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000HalSim.cpp
+ * Simulated implementation of the hardware abstraction (see DW1000HalSim.h).
+ *
+ * The register model covers what the driver relies on: plain storage for
+ * configuration, write-1-to-clear SYS_STATUS, commands in SYS_CTRL (immediate
+ * and delayed TX/RX, TRXOFF, WAIT4RESP, HRBPT), frame wait and preamble detection
+ * timeouts, frame filtering and auto-acknowledge, preamble sniff mode, SYS_TIME,
+ * TX/RX timestamps with antenna delays, the double receive buffer, soft resets and
+ * the IRQ line. Everything else (OTP, LDE, analog tuning, sleep) reads back
+ * what was written.
+ */
+
+#include "DW1000Hal.h"
+
+#if DW1000_HAL == DW1000_HAL_SIM
+
+#include <math.h>
+#include <functional>
+#include <map>
+#include <vector>
+#include "DW1000Constants.h"
+
+#define SIM_TIME_MASK 0xFFFFFFFFFFULL     // 40 bit system time
+#define SIM_TICKS_PER_NS 63.8976          // 499.2 MHz * 128
+#define SIM_SPEED_OF_LIGHT 0.299792458    // [m/ns]
+#define SIM_FWTO_UNIT_NS (512000.0/499.2) // RX_FWTO, SNIFF_OFFT and W4R_TIM unit, ~1 us
+#define SIM_PREAMBLE_SYMBOLS_DEFAULT 128
+
+// registers that exist once per receive buffer
+static const byte SIM_RX_REGS[4] = {RX_FINFO, RX_BUFFER, RX_FQUAL, RX_TIME};
+
+struct SimChip {
+	uint8_t ss;
+	uint8_t irq;
+	uint8_t rst;
+	float x, y, z;
+	uint64_t clockOffset; // [ticks] chips do not share a time base
+	std::vector<byte> regs[64];
+	// SPI decoding
+	boolean selected;
+	byte header[3];
+	uint8_t headerLen;
+	boolean headerDone;
+	boolean write;
+	byte reg;
+	uint16_t offset;
+	uint16_t writeStart;
+	// radio
+	boolean rxOn;
+	boolean rxBusy;
+	boolean rxAfterTx;
+	boolean rxNoFcs; // started with SFCST, the FCS is not checked
+	uint32_t rxGen; // incremented by every RX (re)start, outdated events are dropped
+	uint32_t rxFrame;
+	uint8_t preambles; // frames on air at the antenna which are still in their preamble
+	// time the receiver was listening (sniff off periods excluded) up to rxSince [ns]
+	double rxListen;
+	uint64_t rxSince;
+	// double receive buffer: the registers of the buffer the host does not see, its RX status
+	// bits and which buffers hold a frame not released by the host
+	std::vector<byte> rxOther[4];
+	uint32_t rxOtherStatus;
+	boolean rxHeld[2];
+	uint8_t hsrbp;
+	uint8_t icrbp;
+	boolean txBusy;
+	uint32_t txGen;
+	// interrupt line
+	boolean irqLevel;
+	boolean irqPending;
+	// statistics
+	uint32_t transactions;
+	uint32_t bytes;
+	uint32_t interrupts;
+	uint32_t frames;
+	double airTime;
+};
+
+struct SimFrame {
+	uint32_t id;
+	std::vector<byte> data;
+	uint32_t fctrl;  // TX_FCTRL of the sender, for air time and RX_FINFO
+	double prefix;   // [ns] preamble and SFD
+	double rmarker;  // [ns] start of PHY header at the sender
+	double payload;  // [ns] PHY header and data
+	float x, y, z;
+};
+
+static std::vector<SimChip> _chips;
+static std::multimap<uint64_t, std::function<void()> > _events;
+static uint64_t _now = 0;
+static uint32_t _pollStep = 1000;
+static uint32_t _spiClock = 2000000L;
+static boolean _inTransaction = false;
+static boolean _inIsr = false;
+static uint32_t _frameIds = 0;
+static void (* _isr[256])(void);
+static void (* _handleTransmit)(uint8_t, const byte[], uint16_t) = 0;
+
+/* ###########################################################################
+ * #### Helpers ##############################################################
+ * ######################################################################### */
+
+static SimChip* findChip(uint8_t ss) {
+	for(size_t i = 0; i < _chips.size(); i++) {
+		if(_chips[i].ss == ss) {
+			return &_chips[i];
+		}
+	}
+	return 0;
+}
+
+static byte* regBytes(SimChip& c, byte reg, uint16_t offset, uint16_t n) {
+	std::vector<byte>& r = c.regs[reg & 0x3F];
+	if(r.size() < (size_t)offset+n) {
+		r.resize(offset+n, 0);
+	}
+	return &r[offset];
+}
+
+static uint64_t getValue(SimChip& c, byte reg, uint16_t offset, uint16_t n) {
+	byte* b = regBytes(c, reg, offset, n);
+	uint64_t val = 0;
+	for(int i = n-1; i >= 0; i--) {
+		val = (val << 8) | b[i];
+	}
+	return val;
+}
+
+static void setValue(SimChip& c, byte reg, uint16_t offset, uint64_t val, uint16_t n) {
+	byte* b = regBytes(c, reg, offset, n);
+	for(uint16_t i = 0; i < n; i++) {
+		b[i] = (byte)(val >> (8*i));
+	}
+}
+
+static void setStatus(SimChip& c, uint64_t bits) {
+	setValue(c, SYS_STATUS, 0, getValue(c, SYS_STATUS, 0, LEN_SYS_STATUS) | bits, LEN_SYS_STATUS);
+}
+
+static uint64_t ticks(const SimChip& c, double ns) {
+	return ((uint64_t)llround(ns*SIM_TICKS_PER_NS)+c.clockOffset) & SIM_TIME_MASK;
+}
+
+/* [ns] from now until the chip clock reaches a (40 bit) system time. */
+static double untilTicks(const SimChip& c, uint64_t time) {
+	return (double)((time-ticks(c, _now)) & SIM_TIME_MASK)/SIM_TICKS_PER_NS;
+}
+
+/* IEEE 802.15.4 FCS (CRC-16 ITU-T, bit reversed). */
+static uint16_t crc16(const byte data[], uint16_t n) {
+	uint16_t crc = 0;
+	for(uint16_t i = 0; i < n; i++) {
+		crc ^= data[i];
+		for(uint8_t b = 0; b < 8; b++) {
+			crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : (crc >> 1);
+		}
+	}
+	return crc;
+}
+
+static uint16_t preambleSymbols(uint32_t fctrl) {
+	static const uint16_t PSR_SYMBOLS[16] = {0, 64, 1024, 4096, 0, 128, 1536, 0, 0, 256, 2048, 0, 0, 512, 0, 0};
+	uint16_t symbols = PSR_SYMBOLS[(fctrl >> 18) & 0x0F];
+	return (symbols != 0 ? symbols : SIM_PREAMBLE_SYMBOLS_DEFAULT);
+}
+
+/* [ns] per preamble symbol. */
+static double symbolTime(uint32_t fctrl) {
+	return (((fctrl >> 16) & 0x03) == 2 ? 1017.63 : 993.59);
+}
+
+/* preamble acquisition chunk as chosen by the driver for the preamble length [symbols]. */
+static uint8_t pacSymbols(uint32_t fctrl) {
+	uint16_t symbols = preambleSymbols(fctrl);
+	return (symbols <= 128 ? 8 : (symbols <= 512 ? 16 : (symbols <= 1024 ? 32 : 64)));
+}
+
+/* preamble + SFD ("prefix") and PHY header + data ("payload") durations [ns]. */
+static void airtime(uint32_t fctrl, uint16_t len, double* prefix, double* payload) {
+	byte     rate    = (fctrl >> 13) & 0x03;
+	uint16_t symbols = preambleSymbols(fctrl);
+	double   symbol  = symbolTime(fctrl);
+	double   bit     = (rate == 0 ? 8205.13 : (rate == 1 ? 1025.64 : 128.21));
+	double phrBit = (rate == 0 ? 8205.13 : 1025.64);
+	*prefix  = (symbols+(rate == 0 ? 64 : 8))*symbol;
+	// data is Reed-Solomon coded, 48 parity bits per 330 data bits
+	*payload = 21*phrBit+len*8*(1.0+48.0/330.0)*bit;
+}
+
+static void schedule(double at, const std::function<void()>& event) {
+	uint64_t t = (at <= (double)_now ? _now : (uint64_t)ceil(at));
+	_events.insert(std::make_pair(t, event));
+}
+
+static boolean doubleBuffered(SimChip& c) {
+	return !((getValue(c, SYS_CFG, 0, LEN_SYS_CFG) >> DIS_DRXB_BIT) & 1);
+}
+
+static void swapRxBuffers(SimChip& c) {
+	for(uint8_t i = 0; i < 4; i++) {
+		c.regs[SIM_RX_REGS[i]].swap(c.rxOther[i]);
+	}
+}
+
+static void updateIrq(SimChip& c) {
+	// read-only buffer pointers
+	byte* pointers = regBytes(c, SYS_STATUS, 3, 1);
+	*pointers = (*pointers & 0x3F) | (c.hsrbp << (HSRBP_BIT-24)) | (c.icrbp << (ICRBP_BIT-24));
+	uint32_t status = (uint32_t)getValue(c, SYS_STATUS, 0, 4);
+	uint32_t mask   = (uint32_t)getValue(c, SYS_MASK, 0, LEN_SYS_MASK);
+	boolean  level  = ((status & mask & ~1UL) != 0);
+	byte*    irqs   = regBytes(c, SYS_STATUS, 0, 1);
+	*irqs = (level ? (*irqs | 0x01) : (*irqs & 0xFE));
+	if(level && !c.irqLevel) {
+		c.irqPending = true;
+	}
+	c.irqLevel = level;
+}
+
+/* run pending interrupt handlers, never nested and never within an SPI transaction. */
+static void serviceInterrupts() {
+	boolean again = true;
+	if(_inTransaction || _inIsr) {
+		return;
+	}
+	while(again) {
+		again = false;
+		for(size_t i = 0; i < _chips.size(); i++) {
+			if(!_chips[i].irqPending) {
+				continue;
+			}
+			_chips[i].irqPending = false;
+			if(_isr[_chips[i].irq] == 0) {
+				continue;
+			}
+			_chips[i].interrupts++;
+			_inIsr = true;
+			(*_isr[_chips[i].irq])();
+			_inIsr = false;
+			again = true;
+		}
+	}
+}
+
+static void runUntil(uint64_t t) {
+	while(!_events.empty() && _events.begin()->first <= t) {
+		std::multimap<uint64_t, std::function<void()> >::iterator first = _events.begin();
+		std::function<void()> event = first->second;
+		if(first->first > _now) {
+			_now = first->first;
+		}
+		_events.erase(first);
+		event();
+		serviceInterrupts();
+	}
+	if(t > _now) {
+		_now = t;
+	}
+	serviceInterrupts();
+}
+
+/* ###########################################################################
+ * #### Chip model ###########################################################
+ * ######################################################################### */
+
+/* preamble sniff mode (RX_SNIFF): on and off periods while hunting for a preamble [ns], 0 if off.
+ * The receiver is only switched off with PLL2_SEQ_EN (PMSC_CTRL0) set. */
+static double sniffPeriods(SimChip& c, double* on) {
+	uint32_t fctrl = (uint32_t)getValue(c, TX_FCTRL, 0, LEN_TX_FCTRL);
+	byte*    sniff = regBytes(c, RX_SNIFF, 0, LEN_RX_SNIFF);
+	boolean  sequenced = (getValue(c, PMSC, PMSC_CTRL0_SUB, LEN_PMSC_CTRL0) >> PLL2_SEQ_EN_BIT) & 1;
+	*on = ((sniff[0] & 0x0F)+1)*pacSymbols(fctrl)*symbolTime(fctrl);
+	return (sequenced ? sniff[1]*SIM_FWTO_UNIT_NS : 0);
+}
+
+/* listening time so far, to be called before the receiver state changes. */
+static void accountReceiver(SimChip& c) {
+	if(c.rxOn) {
+		double on, off = sniffPeriods(c, &on);
+		double duty = (c.rxBusy || off == 0 ? 1.0 : on/(on+off));
+		c.rxListen += (_now-c.rxSince)*duty;
+	}
+	c.rxSince = _now;
+}
+
+static void resetChip(SimChip& c) {
+	accountReceiver(c);
+	for(uint8_t i = 0; i < 64; i++) {
+		c.regs[i].clear();
+	}
+	setValue(c, DEV_ID, 0, 0xDECA0130, LEN_DEV_ID);
+	setValue(c, PANADR, 0, 0xFFFFFFFF, LEN_PANADR);
+	setValue(c, SYS_CFG, 0, 0x00001200, LEN_SYS_CFG);
+	setValue(c, TX_FCTRL, 0, 0x0015400C, LEN_TX_FCTRL);
+	setValue(c, PMSC, PMSC_CTRL0_SUB, 0xF0300200, LEN_PMSC_CTRL0);
+	c.rxOn      = false;
+	c.rxBusy    = false;
+	c.rxAfterTx = false;
+	c.txBusy    = false;
+	c.rxGen++;
+	c.txGen++;
+	c.preambles = 0;
+	for(uint8_t i = 0; i < 4; i++) {
+		c.rxOther[i].clear();
+	}
+	c.rxOtherStatus = 0;
+	c.rxHeld[0] = c.rxHeld[1] = false;
+	c.hsrbp = c.icrbp = 0;
+	c.irqLevel   = false;
+	c.irqPending = false;
+}
+
+static void receiveTimeout(size_t idx, uint32_t gen) {
+	SimChip& c = _chips[idx];
+	if(c.rxGen != gen || !c.rxOn || c.rxBusy) {
+		return;
+	}
+	accountReceiver(c);
+	c.rxOn = false;
+	setStatus(c, 1UL << RXRFTO_BIT);
+	updateIrq(c);
+}
+
+/* no preamble detected so far: none on air at the antenna, and none locked on (RXPRD). */
+static void preambleTimeout(size_t idx, uint32_t gen) {
+	SimChip& c = _chips[idx];
+	if(c.rxGen != gen || !c.rxOn || c.rxBusy || c.preambles > 0) {
+		return;
+	}
+	accountReceiver(c);
+	c.rxOn = false;
+	setStatus(c, 1UL << RXPTO_BIT);
+	updateIrq(c);
+}
+
+static void receiveOn(size_t idx) {
+	SimChip& c = _chips[idx];
+	accountReceiver(c);
+	c.rxOn   = true;
+	c.rxBusy = false;
+	uint32_t gen = ++c.rxGen;
+	uint16_t fwto = (uint16_t)getValue(c, RX_FWTO, 0, LEN_RX_FWTO);
+	if(((getValue(c, SYS_CFG, 0, LEN_SYS_CFG) >> RXWTOE_BIT) & 1) && fwto > 0) {
+		schedule(_now+fwto*SIM_FWTO_UNIT_NS, [idx, gen]() { receiveTimeout(idx, gen); });
+	}
+	uint16_t pretoc = (uint16_t)getValue(c, DRX_TUNE, DRX_PRETOC_SUB, LEN_DRX_PRETOC);
+	if(pretoc > 0) {
+		uint32_t fctrl = (uint32_t)getValue(c, TX_FCTRL, 0, LEN_TX_FCTRL);
+		schedule(_now+pretoc*pacSymbols(fctrl)*symbolTime(fctrl), [idx, gen]() { preambleTimeout(idx, gen); });
+	}
+}
+
+static void storeFrame(SimChip& c, const SimFrame& f, double rmarker, float distance);
+static void sendAcknowledge(size_t idx, const SimFrame& received);
+
+/* start of a preamble arrives, a receiver turned on before its SFD still detects it. */
+static void preambleArrival(size_t idx) {
+	_chips[idx].preambles++;
+}
+
+/* start of PHY header arrives: preamble and SFD detected, receiver locks on the frame. */
+static void frameArrival(size_t idx, uint32_t frame, double prefix) {
+	SimChip& c = _chips[idx];
+	if(c.preambles > 0) {
+		c.preambles--;
+	}
+	if(!c.rxOn || c.rxBusy) {
+		return;
+	}
+	double on, off = sniffPeriods(c, &on);
+	if(off > 0 && prefix < off+2*on) {
+		// sniffing, the preamble may fall into an off period: detected only if it spans a full on period
+		return;
+	}
+	accountReceiver(c);
+	c.rxBusy  = true;
+	c.rxFrame = frame;
+	setStatus(c, (1UL << RXPRD_BIT) | (1UL << RXSFDD_BIT));
+	updateIrq(c);
+}
+
+/* frame filtering (FFEN): frame type allowed and, if it has a destination, addressed to the chip.
+ * Whether the chip acknowledges the frame (auto-acknowledge) is returned as well. */
+static boolean frameAccepted(SimChip& c, const SimFrame& f, boolean* acknowledge) {
+	static const byte ALLOW_BITS[8] = {FFAB_BIT, FFAD_BIT, FFAA_BIT, FFAM_BIT, FFA4_BIT, FFA5_BIT, FFAR_BIT, FFAR_BIT};
+	uint32_t cfg = (uint32_t)getValue(c, SYS_CFG, 0, LEN_SYS_CFG);
+	uint16_t len = (uint16_t)f.data.size();
+	*acknowledge = false;
+	if(!((cfg >> FFEN_BIT) & 1)) {
+		return true;
+	}
+	if(len < 3) {
+		return false;
+	}
+	byte type = f.data[0] & 0x07;
+	if(!((cfg >> ALLOW_BITS[type]) & 1)) {
+		return false;
+	}
+	if(type == 2 || type >= 4) {
+		// acknowledgements and reserved types carry no addresses to check
+		return true;
+	}
+	byte dstMode = (f.data[1] >> 2) & 0x03;
+	if(dstMode == 0) {
+		return (type == 0 || ((cfg >> FFBC_BIT) & 1));
+	}
+	if(dstMode == 1 || len < (dstMode == 2 ? 7 : 13)) {
+		return false;
+	}
+	uint16_t pan = f.data[3] | ((uint16_t)f.data[4] << 8);
+	if(pan != 0xFFFF && pan != (uint16_t)getValue(c, PANADR, PAN_ID, LEN_PAN_ID)) {
+		return false;
+	}
+	boolean broadcast = false;
+	if(dstMode == 2) {
+		uint16_t dst = f.data[5] | ((uint16_t)f.data[6] << 8);
+		broadcast = (dst == 0xFFFF);
+		if(!broadcast && dst != (uint16_t)getValue(c, PANADR, SHORT_ADDR, LEN_SHORT_ADDR)) {
+			return false;
+		}
+	} else if(memcmp(&f.data[5], regBytes(c, EUI, 0, LEN_EUI), LEN_EUI) != 0) {
+		return false;
+	}
+	*acknowledge = ((cfg >> AUTOACK_BIT) & 1) && !broadcast && (f.data[0] & 0x20) && (type == 1 || type == 3);
+	return true;
+}
+
+static void frameReceived(size_t idx, const SimFrame& f, double rmarker, float distance) {
+	SimChip& c = _chips[idx];
+	if(!c.rxOn || !c.rxBusy || c.rxFrame != f.id) {
+		return;
+	}
+	// the receiver state changes in any case
+	accountReceiver(c);
+	uint16_t len = (uint16_t)f.data.size();
+	if(!c.rxNoFcs && len >= 2 && crc16(&f.data[0], len-2) != ((uint16_t)f.data[len-2] | ((uint16_t)f.data[len-1] << 8))) {
+		// FCS error, the receiver re-enables itself if RXAUTR is set
+		storeFrame(c, f, rmarker, distance);
+		c.rxBusy = false;
+		if(!((getValue(c, SYS_CFG, 0, LEN_SYS_CFG) >> RXAUTR_BIT) & 1)) {
+				c.rxOn = false;
+		}
+		setStatus(c, (1UL << LDEDONE_BIT) | (1UL << RXPHD_BIT) | (1UL << RXDFR_BIT) | (1UL << RXFCE_BIT));
+		updateIrq(c);
+		return;
+	}
+	boolean acknowledge;
+	if(!frameAccepted(c, f, &acknowledge)) {
+		// rejected, the receiver re-enables itself if RXAUTR is set
+		c.rxBusy = false;
+		if(!((getValue(c, SYS_CFG, 0, LEN_SYS_CFG) >> RXAUTR_BIT) & 1)) {
+				c.rxOn = false;
+		}
+		setStatus(c, 1UL << AFFREJ_BIT);
+		updateIrq(c);
+		return;
+	}
+	uint32_t rxStatus = (1UL << LDEDONE_BIT) | (1UL << RXPHD_BIT) | (1UL << RXDFR_BIT) | (1UL << RXFCG_BIT);
+	if(acknowledge) {
+		rxStatus |= (1UL << AAT_BIT);
+	}
+	if(!doubleBuffered(c)) {
+		storeFrame(c, f, rmarker, distance);
+		c.rxOn   = false;
+		c.rxBusy = false;
+		setStatus(c, rxStatus);
+		if(acknowledge) {
+			sendAcknowledge(idx, f);
+		}
+		updateIrq(c);
+		return;
+	}
+	// double buffered: the receiver stays on and fills the buffers in turn
+	uint8_t b = c.icrbp;
+	c.rxBusy = false;
+	if(c.rxHeld[b]) {
+		// both buffers are full, the frame is lost and the receiver stops
+		c.rxOn = false;
+		setStatus(c, 1UL << RXOVRR_BIT);
+		updateIrq(c);
+		return;
+	}
+	c.rxHeld[b] = true;
+	c.icrbp = b^1;
+	if(b == c.hsrbp) {
+		storeFrame(c, f, rmarker, distance);
+		setStatus(c, rxStatus);
+	} else {
+		// the host still reads the other buffer, the frame is reported once it toggles over (HRBPT)
+		swapRxBuffers(c);
+		storeFrame(c, f, rmarker, distance);
+		swapRxBuffers(c);
+		c.rxOtherStatus = rxStatus;
+	}
+	updateIrq(c);
+}
+
+/* frame data and metadata into the receive registers (of the buffer the host sees). */
+static void storeFrame(SimChip& c, const SimFrame& f, double rmarker, float distance) {
+	uint16_t len = (uint16_t)f.data.size();
+	memcpy(regBytes(c, RX_BUFFER, 0, len), &f.data[0], len);
+	// RX_FINFO: length, data rate, PRF and preamble accumulation count
+	uint32_t finfo = len | (((f.fctrl >> 13) & 0x03UL) << 13) | (((f.fctrl >> 16) & 0x03UL) << 18) | (118UL << 20);
+	setValue(c, RX_FINFO, 0, finfo, LEN_RX_FINFO);
+	// RX_TIME: adjusted and raw timestamp, first path
+	uint64_t raw    = ticks(c, rmarker);
+	uint16_t rxAntd = (uint16_t)getValue(c, LDE_IF, LDE_RXANTD_SUB, LEN_LDE_RXANTD);
+	uint16_t ampl   = (uint16_t)(8000.0f/(1.0f+distance/10.0f));
+	setValue(c, RX_TIME, RX_STAMP_SUB, (raw-rxAntd) & SIM_TIME_MASK, LEN_RX_STAMP);
+	setValue(c, RX_TIME, 5, 745UL << 6, 2);
+	setValue(c, RX_TIME, FP_AMPL1_SUB, ampl, LEN_FP_AMPL1);
+	setValue(c, RX_TIME, 9, raw & ~0x1FFULL, LEN_STAMP);
+	// RX_FQUAL
+	setValue(c, RX_FQUAL, STD_NOISE_SUB, 40, LEN_STD_NOISE);
+	setValue(c, RX_FQUAL, FP_AMPL2_SUB, ampl, LEN_FP_AMPL2);
+	setValue(c, RX_FQUAL, FP_AMPL3_SUB, ampl*3/4, LEN_FP_AMPL3);
+	setValue(c, RX_FQUAL, CIR_PWR_SUB, ampl, LEN_CIR_PWR);
+}
+
+/* schedule reception of a frame at a chip. */
+static void scheduleReception(size_t idx, const SimFrame& f, float distance) {
+	double arrival = f.rmarker+distance/SIM_SPEED_OF_LIGHT;
+	uint32_t id = f.id;
+	schedule(arrival-f.prefix, [idx]() { preambleArrival(idx); });
+	double prefix = f.prefix;
+	schedule(arrival, [idx, id, prefix]() { frameArrival(idx, id, prefix); });
+	schedule(arrival+f.payload, [idx, f, arrival, distance]() { frameReceived(idx, f, arrival, distance); });
+}
+
+/* schedule reception of a frame at all chips but the sender. */
+static void propagate(const SimFrame& f, int sender) {
+	for(size_t i = 0; i < _chips.size(); i++) {
+		if((int)i == sender) {
+			continue;
+		}
+		float dx = _chips[i].x-f.x, dy = _chips[i].y-f.y, dz = _chips[i].z-f.z;
+		scheduleReception(i, f, sqrtf(dx*dx+dy*dy+dz*dz));
+	}
+}
+
+static void transmitDone(size_t idx, uint32_t gen, const SimFrame& f, uint64_t stamp, boolean waitForResponse) {
+	SimChip& c = _chips[idx];
+	if(c.txGen != gen) {
+		return;
+	}
+	uint16_t txAntd = (uint16_t)getValue(c, TX_ANTD, 0, LEN_TX_ANTD);
+	setValue(c, TX_TIME, TX_STAMP_SUB, (stamp+txAntd) & SIM_TIME_MASK, LEN_TX_STAMP);
+	setValue(c, TX_TIME, 5, stamp, LEN_STAMP);
+	setStatus(c, (1UL << TXPRS_BIT) | (1UL << TXPHS_BIT) | (1UL << TXFRS_BIT));
+	c.txBusy = false;
+	c.frames++;
+	c.airTime += f.prefix+f.payload;
+	// W4R_TIM of ACK_RESP_T delays the receiver after a WAIT4RESP frame
+	uint32_t w4r = waitForResponse ? (uint32_t)getValue(c, ACK_RESP_T, W4R_TIM_SUB, LEN_W4R_TIM) & 0xFFFFF : 0;
+	if(w4r > 0) {
+		c.rxAfterTx = false;
+		uint32_t rxGen = ++c.rxGen;
+		schedule(_now+w4r*SIM_FWTO_UNIT_NS, [idx, rxGen]() {
+			if(_chips[idx].rxGen == rxGen) {
+				receiveOn(idx);
+			}
+		});
+	} else if(waitForResponse || c.rxAfterTx) {
+		c.rxAfterTx = false;
+		receiveOn(idx);
+	}
+	updateIrq(c);
+	if(_handleTransmit != 0) {
+		(*_handleTransmit)(c.ss, &f.data[0], (uint16_t)f.data.size());
+	}
+}
+
+/* put a frame on air, its PHY header leaves at f.rmarker. */
+static void sendFrame(size_t idx, const SimFrame& f, uint64_t stamp, boolean waitForResponse) {
+	SimChip& c = _chips[idx];
+	c.txBusy = true;
+	uint32_t gen = ++c.txGen;
+	schedule(f.rmarker-f.prefix, [idx, gen]() {
+		if(_chips[idx].txGen == gen) {
+			setStatus(_chips[idx], 1UL << TXFRB_BIT);
+			updateIrq(_chips[idx]);
+		}
+	});
+	schedule(f.rmarker+f.payload, [idx, gen, f, stamp, waitForResponse]() { transmitDone(idx, gen, f, stamp, waitForResponse); });
+	propagate(f, (int)idx);
+}
+
+/* acknowledgement of a received frame, sent by the chip itself (auto-acknowledge). */
+static void sendAcknowledge(size_t idx, const SimFrame& received) {
+	SimChip& c = _chips[idx];
+	uint32_t fctrl = (uint32_t)getValue(c, TX_FCTRL, 0, LEN_TX_FCTRL);
+	uint8_t  ackTim = (uint8_t)getValue(c, ACK_RESP_T, ACK_TIM_SUB, LEN_ACK_TIM);
+	SimFrame f;
+	f.id = ++_frameIds;
+	f.data.resize(5);
+	f.data[0] = 0x02; // acknowledgement frame
+	f.data[1] = 0x00;
+	f.data[2] = received.data[2];
+	uint16_t fcs = crc16(&f.data[0], 3);
+	f.data[3] = (byte)fcs;
+	f.data[4] = (byte)(fcs >> 8);
+	f.fctrl = fctrl;
+	airtime(fctrl, 5, &f.prefix, &f.payload);
+	f.rmarker = _now+ackTim*symbolTime(fctrl)+f.prefix;
+	f.x = c.x; f.y = c.y; f.z = c.z;
+	accountReceiver(c);
+	c.rxOn   = false;
+	c.rxBusy = false;
+	sendFrame(idx, f, ticks(c, f.rmarker), false);
+}
+
+static void transmit(size_t idx, boolean delayed, boolean waitForResponse, boolean suppressFcs) {
+	SimChip& c = _chips[idx];
+	uint64_t fctrl = getValue(c, TX_FCTRL, 0, LEN_TX_FCTRL);
+	uint16_t len   = fctrl & 0x03FF;
+	uint16_t boffs = (fctrl >> 22) & 0x03FF;
+	double   prefix, payload;
+	uint64_t stamp;
+	SimFrame f;
+	airtime((uint32_t)fctrl, len, &prefix, &payload);
+	f.id = ++_frameIds;
+	f.data.assign(regBytes(c, TX_BUFFER, boffs, len), regBytes(c, TX_BUFFER, boffs, len)+len);
+	if(!suppressFcs && len >= 2) {
+		uint16_t fcs = crc16(&f.data[0], len-2);
+		f.data[len-2] = (byte)fcs;
+		f.data[len-1] = (byte)(fcs >> 8);
+	}
+	f.fctrl   = (uint32_t)fctrl;
+	f.prefix  = prefix;
+	f.payload = payload;
+	f.x = c.x; f.y = c.y; f.z = c.z;
+	if(delayed) {
+		// the PHY header leaves at DX_TIME (low 9 bits ignored), too late means after the next wrap
+		stamp = getValue(c, DX_TIME, 0, LEN_DX_TIME) & SIM_TIME_MASK & ~0x1FFULL;
+		double until = untilTicks(c, stamp);
+		if(until < prefix || until*SIM_TICKS_PER_NS >= (double)(1ULL << 39)) {
+			setStatus(c, 1UL << HPDWARN);
+			if(until < prefix) {
+				until += (double)(SIM_TIME_MASK+1)/SIM_TICKS_PER_NS;
+			}
+		}
+		f.rmarker = _now+until;
+	} else {
+		f.rmarker = _now+prefix;
+		stamp     = ticks(c, f.rmarker);
+	}
+	sendFrame(idx, f, stamp, waitForResponse);
+}
+
+static void systemControl(size_t idx) {
+	SimChip& c = _chips[idx];
+	uint32_t ctrl = (uint32_t)getValue(c, SYS_CTRL, 0, LEN_SYS_CTRL);
+	// command bits clear themselves
+	setValue(c, SYS_CTRL, 0, 0, LEN_SYS_CTRL);
+	if(ctrl & (1UL << TRXOFF_BIT)) {
+		accountReceiver(c);
+		c.rxOn      = false;
+		c.rxBusy    = false;
+		c.rxAfterTx = false;
+		c.txBusy    = false;
+		c.rxGen++;
+		c.txGen++;
+	}
+	if(ctrl & (1UL << HRBPT_BIT)) {
+		// host releases its receive buffer and turns to the other one
+		c.rxHeld[c.hsrbp] = false;
+		c.hsrbp ^= 1;
+		swapRxBuffers(c);
+		if(c.rxHeld[c.hsrbp]) {
+			setStatus(c, c.rxOtherStatus);
+		}
+		c.rxOtherStatus = 0;
+	}
+	if(ctrl & (1UL << TXSTRT_BIT)) {
+		c.rxNoFcs = (ctrl & (1UL << SFCST_BIT));
+		transmit(idx, ctrl & (1UL << TXDLYS_BIT), ctrl & (1UL << WAIT4RESP_BIT), ctrl & (1UL << SFCST_BIT));
+	} else if(ctrl & (1UL << RXENAB_BIT)) {
+		c.rxNoFcs = (ctrl & (1UL << SFCST_BIT));
+		if(c.txBusy) {
+			// receiver turns on as soon as the frame is out
+			c.rxAfterTx = true;
+		} else if(ctrl & (1UL << RXDLYS_BIT)) {
+			uint32_t gen = ++c.rxGen;
+			schedule(_now+untilTicks(c, getValue(c, DX_TIME, 0, LEN_DX_TIME) & ~0x1FFULL), [idx, gen]() {
+				if(_chips[idx].rxGen == gen) {
+					receiveOn(idx);
+				}
+			});
+		} else {
+			receiveOn(idx);
+		}
+	}
+}
+
+/* chip select raised: apply what the transaction wrote. */
+static void deselect(size_t idx) {
+	SimChip& c = _chips[idx];
+	c.selected = false;
+	if(!c.headerDone || !c.write) {
+		return;
+	}
+	if(c.reg == SYS_CTRL) {
+		systemControl(idx);
+	} else if(c.reg == PMSC && c.writeStart <= 3 && c.offset > 3 && (*regBytes(c, PMSC, 3, 1) & 0xF0) == 0) {
+		// soft reset, everything but PMSC falls back to defaults
+		std::vector<byte> pmsc = c.regs[PMSC];
+		resetChip(c);
+		c.regs[PMSC] = pmsc;
+	} else if(c.reg == PMSC && c.writeStart <= 3 && c.offset > 3 && (*regBytes(c, PMSC, 3, 1) & 0xF0) == SOFTRESET_RX) {
+		// receiver reset, frames in the buffers are dropped and the buffer pointers synchronized
+		accountReceiver(c);
+		c.rxOn   = false;
+		c.rxBusy = false;
+		c.rxGen++;
+		c.rxHeld[0] = c.rxHeld[1] = false;
+		c.rxOtherStatus = 0;
+		c.icrbp = c.hsrbp;
+	}
+	updateIrq(c);
+}
+
+static byte exchange(SimChip& c, byte in) {
+	c.bytes++;
+	if(!c.headerDone) {
+		c.header[c.headerLen++] = in;
+		if(!(c.header[0] & 0x40)) {
+			c.offset = 0;
+		} else if(c.headerLen == 2 && !(c.header[1] & 0x80)) {
+			c.offset = c.header[1];
+		} else if(c.headerLen == 3) {
+			c.offset = (c.header[1] & 0x7F) | ((uint16_t)c.header[2] << 7);
+		} else {
+			return JUNK;
+		}
+		c.headerDone = true;
+		c.write      = (c.header[0] & 0x80);
+		c.reg        = c.header[0] & 0x3F;
+		c.writeStart = c.offset;
+		if(!c.write && c.reg == SYS_TIME) {
+			setValue(c, SYS_TIME, 0, ticks(c, _now) & ~0x1FFULL, LEN_SYS_TIME);
+		}
+		return JUNK;
+	}
+	if(!c.write) {
+		return *regBytes(c, c.reg, c.offset++, 1);
+	}
+	byte* b = regBytes(c, c.reg, c.offset++, 1);
+	if(c.reg == SYS_STATUS) {
+		*b &= ~in; // write 1 to clear, the buffer pointers are restored by updateIrq()
+	} else {
+		*b = in;
+	}
+	return JUNK;
+}
+
+static SimChip* selectedChip() {
+	for(size_t i = 0; i < _chips.size(); i++) {
+		if(_chips[i].selected) {
+			return &_chips[i];
+		}
+	}
+	return 0;
+}
+
+static void spiTime(uint16_t n) {
+	runUntil(_now+(uint64_t)n*8000000000ULL/_spiClock);
+}
+
+/* ###########################################################################
+ * #### HAL ##################################################################
+ * ######################################################################### */
+
+void DW1000HalSim::spiBegin(uint8_t /* irq */) {
+}
+
+void DW1000HalSim::spiEnd() {
+}
+
+void DW1000HalSim::spiBeginTransaction(const SpiSettings& settings) {
+	_spiClock      = settings;
+	_inTransaction = true;
+}
+
+void DW1000HalSim::spiEndTransaction() {
+	_inTransaction = false;
+	serviceInterrupts();
+}
+
+void DW1000HalSim::spiRead(byte data[], uint16_t n) {
+	SimChip* c = selectedChip();
+	for(uint16_t i = 0; i < n; i++) {
+		data[i] = (c != 0 ? exchange(*c, JUNK) : JUNK);
+	}
+	spiTime(n);
+}
+
+void DW1000HalSim::spiWrite(const byte data[], uint16_t n) {
+	SimChip* c = selectedChip();
+	for(uint16_t i = 0; c != 0 && i < n; i++) {
+		exchange(*c, data[i]);
+	}
+	spiTime(n);
+}
+
+void DW1000HalSim::pinMode(uint8_t /* pin */, uint8_t /* mode */) {
+}
+
+void DW1000HalSim::digitalWrite(uint8_t pin, uint8_t val) {
+	for(size_t i = 0; i < _chips.size(); i++) {
+		SimChip& c = _chips[i];
+		if(c.ss == pin && val == LOW && !c.selected) {
+			c.selected   = true;
+			c.headerLen  = 0;
+			c.headerDone = false;
+			c.transactions++;
+		} else if(c.ss == pin && val == HIGH && c.selected) {
+			deselect(i);
+		} else if(c.rst == pin && val == LOW) {
+			resetChip(c);
+		}
+	}
+}
+
+uint8_t DW1000HalSim::digitalRead(uint8_t pin) {
+	for(size_t i = 0; i < _chips.size(); i++) {
+		if(_chips[i].irq == pin) {
+			return (_chips[i].irqLevel ? HIGH : LOW);
+		}
+	}
+	return LOW;
+}
+
+boolean DW1000HalSim::attachInterrupt(uint8_t pin, void (* isr)(void)) {
+	_isr[pin] = isr;
+	return true;
+}
+
+void DW1000HalSim::delay(uint32_t ms) {
+	runUntil(_now+(uint64_t)ms*1000000ULL);
+}
+
+void DW1000HalSim::delayMicroseconds(uint32_t us) {
+	runUntil(_now+(uint64_t)us*1000ULL);
+}
+
+uint32_t DW1000HalSim::millis() {
+	runUntil(_now+_pollStep);
+	return (uint32_t)(_now/1000000ULL);
+}
+
+uint32_t DW1000HalSim::micros() {
+	runUntil(_now+_pollStep);
+	return (uint32_t)(_now/1000ULL);
+}
+
+/* ###########################################################################
+ * #### Simulation control ###################################################
+ * ######################################################################### */
+
+void DW1000Sim::addChip(uint8_t ss, uint8_t irq, uint8_t rst) {
+	SimChip c = SimChip();
+	c.ss  = ss;
+	c.irq = irq;
+	c.rst = rst;
+	// arbitrary but distinct clock phase per chip
+	c.clockOffset = (0x13579BDF1ULL*(_chips.size()+1)) & SIM_TIME_MASK;
+	resetChip(c);
+	_chips.push_back(c);
+}
+
+void DW1000Sim::setPosition(uint8_t ss, float x, float y, float z) {
+	SimChip* c = findChip(ss);
+	if(c != 0) {
+		c->x = x;
+		c->y = y;
+		c->z = z;
+	}
+}
+
+void DW1000Sim::clear() {
+	_chips.clear();
+	_events.clear();
+	_now = 0;
+	_inTransaction = false;
+	_inIsr = false;
+	memset(_isr, 0, sizeof(_isr));
+}
+
+void DW1000Sim::injectFrame(const byte data[], uint16_t n, float distance, boolean corrupt) {
+	SimFrame f;
+	f.id = ++_frameIds;
+	f.data.assign(data, data+n);
+	f.data.resize(n+2);
+	uint16_t fcs = crc16(data, n);
+	if(corrupt) {
+		fcs = ~fcs;
+	}
+	f.data[n]   = (byte)fcs;
+	f.data[n+1] = (byte)(fcs >> 8);
+	// other stations use the same radio settings as the (first) simulated chip
+	f.fctrl = (_chips.empty() ? 0 : (uint32_t)getValue(_chips[0], TX_FCTRL, 0, LEN_TX_FCTRL));
+	airtime(f.fctrl, n+2, &f.prefix, &f.payload);
+	f.rmarker = _now+f.prefix;
+	for(size_t i = 0; i < _chips.size(); i++) {
+		// place the station at the given distance from every chip
+		SimFrame g = f;
+		g.x = _chips[i].x+distance; g.y = _chips[i].y; g.z = _chips[i].z;
+		scheduleReception(i, g, distance);
+	}
+}
+
+void DW1000Sim::onTransmit(void (* handleTransmit)(uint8_t ss, const byte data[], uint16_t n)) {
+	_handleTransmit = handleTransmit;
+}
+
+uint64_t DW1000Sim::now() {
+	return _now;
+}
+
+void DW1000Sim::advance(uint64_t ns) {
+	runUntil(_now+ns);
+}
+
+void DW1000Sim::setPollStep(uint32_t ns) {
+	_pollStep = ns;
+}
+
+uint32_t DW1000Sim::getTransactionCount(uint8_t ss) {
+	SimChip* c = findChip(ss);
+	return (c != 0 ? c->transactions : 0);
+}
+
+uint32_t DW1000Sim::getByteCount(uint8_t ss) {
+	SimChip* c = findChip(ss);
+	return (c != 0 ? c->bytes : 0);
+}
+
+uint32_t DW1000Sim::getInterruptCount(uint8_t ss) {
+	SimChip* c = findChip(ss);
+	return (c != 0 ? c->interrupts : 0);
+}
+
+uint32_t DW1000Sim::getFrameCount(uint8_t ss) {
+	SimChip* c = findChip(ss);
+	return (c != 0 ? c->frames : 0);
+}
+
+void DW1000Sim::resetStats() {
+	for(size_t i = 0; i < _chips.size(); i++) {
+		_chips[i].transactions = 0;
+		_chips[i].bytes        = 0;
+		_chips[i].interrupts   = 0;
+		_chips[i].frames       = 0;
+		_chips[i].airTime      = 0;
+		accountReceiver(_chips[i]);
+		_chips[i].rxListen     = 0;
+	}
+}
+
+uint64_t DW1000Sim::getAirTime(uint8_t ss) {
+	SimChip* c = findChip(ss);
+	return (c != 0 ? (uint64_t)c->airTime : 0);
+}
+
+uint64_t DW1000Sim::getReceiveTime(uint8_t ss) {
+	SimChip* c = findChip(ss);
+	if(c == 0) {
+		return 0;
+	}
+	accountReceiver(*c);
+	return (uint64_t)c->rxListen;
+}
+
+void DW1000Sim::peek(uint8_t ss, byte reg, uint16_t offset, byte data[], uint16_t n) {
+	SimChip* c = findChip(ss);
+	if(c != 0) {
+		memcpy(data, regBytes(*c, reg, offset, n), n);
+	}
+}
+
+void DW1000Sim::poke(uint8_t ss, byte reg, uint16_t offset, const byte data[], uint16_t n) {
+	SimChip* c = findChip(ss);
+	if(c != 0) {
+		memcpy(regBytes(*c, reg, offset, n), data, n);
+		updateIrq(*c);
+	}
+}
+
+#endif
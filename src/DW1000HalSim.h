@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2015 by Thomas Trojer <thomas@trojer.net>
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000HalSim.h
+ * Simulated implementation of the hardware abstraction (see DW1000Hal.h).
+ *
+ * Nothing leaves the process: chips are modeled in memory and time is virtual.
+ * - SPI: the register protocol is decoded per chip select pin, transfers take
+ *   8 bit times of the configured clock
+ * - radio: frames sent by one simulated chip are received by the others that
+ *   listen, with air time, time of flight and 40 bit timestamps
+ * - interrupt: the IRQ line follows SYS_STATUS & SYS_MASK, the handler runs on
+ *   a rising edge outside of SPI transactions and is never nested
+ * - time: virtual nanoseconds, only advanced by SPI, delays, DW1000Sim::advance()
+ *   and a small step per millis()/micros() call (so polling loops make progress)
+ *
+ * Built with a host toolchain only, see extras/host.
+ */
+
+#ifndef _DW1000HALSIM_H_INCLUDED
+#define _DW1000HALSIM_H_INCLUDED
+
+#include <Arduino.h>
+
+struct DW1000HalSim {
+	typedef uint32_t SpiSettings; // SPI clock [Hz]
+
+	static inline SpiSettings spiSettings(uint32_t clock) {
+		return clock;
+	}
+
+	static void spiBegin(uint8_t irq);
+	static void spiEnd();
+	static void spiBeginTransaction(const SpiSettings& settings);
+	static void spiEndTransaction();
+	static void spiRead(byte data[], uint16_t n);
+	static void spiWrite(const byte data[], uint16_t n);
+
+	static void pinMode(uint8_t pin, uint8_t mode);
+	static void digitalWrite(uint8_t pin, uint8_t val);
+	static uint8_t digitalRead(uint8_t pin);
+	static boolean attachInterrupt(uint8_t pin, void (* isr)(void));
+	static inline void enterCritical() {} // interrupts are run synchronously
+	static inline void exitCritical() {}
+
+	static void delay(uint32_t ms);
+	static void delayMicroseconds(uint32_t us);
+	static uint32_t millis();
+	static uint32_t micros();
+};
+
+/* Control of the simulation, used by host programs (benchmarks, tests). */
+class DW1000Sim {
+public:
+	/* chips, identified by their chip select pin. */
+	static void addChip(uint8_t ss, uint8_t irq, uint8_t rst = 0xff);
+	static void setPosition(uint8_t ss, float x, float y, float z); // [m]
+	static void clear(); // remove all chips and events, rewind time
+
+	/* air: frames of other stations, arriving at all listening chips (corrupt: with a wrong FCS). */
+	static void injectFrame(const byte data[], uint16_t n, float distance = 0.0f, boolean corrupt = false);
+	static void onTransmit(void (* handleTransmit)(uint8_t ss, const byte data[], uint16_t n));
+
+	/* time [ns]. */
+	static uint64_t now();
+	static void advance(uint64_t ns);
+	static void setPollStep(uint32_t ns);
+
+	/* statistics per chip (chip select cycles, bytes, interrupts, frames, air and receiver time). */
+	static uint32_t getTransactionCount(uint8_t ss);
+	static uint32_t getByteCount(uint8_t ss);
+	static uint32_t getInterruptCount(uint8_t ss);
+	static uint32_t getFrameCount(uint8_t ss); // frames sent
+	static uint64_t getAirTime(uint8_t ss); // [ns] frames sent, preamble to last bit
+	static uint64_t getReceiveTime(uint8_t ss); // [ns] receiver listening, sniff off periods excluded
+	static void resetStats();
+
+	/* direct register access, bypassing SPI (no statistics, no time). */
+	static void peek(uint8_t ss, byte reg, uint16_t offset, byte data[], uint16_t n);
+	static void poke(uint8_t ss, byte reg, uint16_t offset, const byte data[], uint16_t n);
+};
+
+#endif
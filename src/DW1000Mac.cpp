@@ -187,13 +187,13 @@ void DW1000Mac::decodeShortMACFrame(byte frame[], byte destAddr[], byte srcAddr[
 {
 	decodeShortMACFrame(frame, srcAddr);
 	//we grab the destination address for the mac frame
-	byte destinationAddress[2];
 	memcpy(destAddr, frame + 5, 2);
 }
 
 void DW1000Mac::decodeShortMACFrame(byte* fc, byte frame[], byte sourceShortAddress[], byte destinationShortAddress[], byte network[])
 {
-
+	memcpy(fc, frame, 2);
+	decodeShortMACFrame(frame, sourceShortAddress, destinationShortAddress, network);
 }
 
 void DW1000Mac::decodeShortMACFrame(byte frame[], byte sourceShortAddress[], byte destinationShortAddress[], byte network[])
@@ -217,7 +217,6 @@ void DW1000Mac::decodeLongMACFrame(byte frame[], byte destAddr[], byte srcAddr[]
 {
 	decodeLongMACFrame(frame, srcAddr);
 	//we grab the destination address for the mac frame
-	byte destinationAddress[8];
 	memcpy(destAddr, frame + 5, 8);
 }
 
@@ -73,6 +73,7 @@
 #define PAN_ID_1 0xCA
 #define PAN_ID_2 0xDE
 
+#define BLINK_LEN 12
 #define SHORT_MAC_LEN 9
 #define LONG_MAC_LEN 15
 
@@ -46,6 +46,11 @@ int16_t DW1000RangingClass::_type; // TODO enum??
 // message flow state
 volatile byte DW1000RangingClass::_expectedMsgId;
 
+// frame filter
+boolean DW1000RangingClass::_useFrameFilter = true;
+// sniff mode
+boolean DW1000RangingClass::_useSniffMode = false;
+
 // range filter
 volatile boolean DW1000RangingClass::_useRangeFilter = false;
 uint16_t DW1000RangingClass::_rangeFilterValue = 15;
@@ -63,6 +68,32 @@ int16_t DW1000RangingClass::counterForBlink = 0; // TODO 8 bit?
 
 // data buffer
 byte DW1000RangingClass::data[LEN_DATA];
+// messages in the transmit buffer
+byte DW1000RangingClass::_txTemplateAddress[TX_TEMPLATES][2];
+byte DW1000RangingClass::_txTemplateType[TX_TEMPLATES];
+uint8_t DW1000RangingClass::_txTemplateLength[TX_TEMPLATES];
+uint16_t DW1000RangingClass::_txTemplateUse[TX_TEMPLATES];
+uint16_t DW1000RangingClass::_txTemplateClock = 0;
+// transmit queue
+uint8_t DW1000RangingClass::_txQueueSlot[TX_QUEUE_SIZE];
+uint8_t DW1000RangingClass::_txQueueLength[TX_QUEUE_SIZE];
+uint32_t DW1000RangingClass::_txQueueReplyUs[TX_QUEUE_SIZE];
+boolean DW1000RangingClass::_txQueueTimed[TX_QUEUE_SIZE];
+DW1000Time DW1000RangingClass::_txQueueTime[TX_QUEUE_SIZE];
+void (*DW1000RangingClass::_txQueueHandler[TX_QUEUE_SIZE])(boolean) = {0};
+uint8_t DW1000RangingClass::_txQueueHead = 0;
+uint8_t DW1000RangingClass::_txQueueCount = 0;
+boolean DW1000RangingClass::_txOnAir = false;
+uint32_t DW1000RangingClass::_txReplyUs = NO_REPLY_WINDOW;
+boolean DW1000RangingClass::_txTimed = false;
+DW1000Time DW1000RangingClass::_txTime;
+uint32_t DW1000RangingClass::_txQueueDue[TX_QUEUE_SIZE];
+uint32_t DW1000RangingClass::_txDue = 0;
+// late transmissions
+uint16_t DW1000RangingClass::_txMarginUS = DEFAULT_TX_MARGIN;
+uint16_t DW1000RangingClass::_txDelayedCount[MESSAGE_TYPES];
+uint16_t DW1000RangingClass::_txLateCount[MESSAGE_TYPES];
+int32_t DW1000RangingClass::_txMinMarginUS[MESSAGE_TYPES];
 // reset line to the chip
 uint8_t DW1000RangingClass::_RST;
 uint8_t DW1000RangingClass::_SS;
@@ -71,6 +102,13 @@ uint32_t DW1000RangingClass::_lastActivity;
 uint32_t DW1000RangingClass::_resetPeriod;
 // reply times (same on both sides for symm. ranging)
 uint16_t DW1000RangingClass::_replyDelayTimeUS;
+// reply windows
+uint16_t DW1000RangingClass::_rxWindowGuardUS = DEFAULT_RX_WINDOW_GUARD;
+boolean DW1000RangingClass::_rxWindow = false;
+uint8_t DW1000RangingClass::_rxWindowSlots = 0;
+boolean DW1000RangingClass::_pollAckReceived[MAX_DEVICES];
+uint32_t DW1000RangingClass::_rxWindowReplyUS = 0;
+volatile boolean DW1000RangingClass::_rxWindowClosed = false;
 //timer delay
 uint16_t DW1000RangingClass::_timerDelay;
 // ranging counter (per second)
@@ -81,6 +119,7 @@ void (*DW1000RangingClass::_handleNewRange)(void) = 0;
 void (*DW1000RangingClass::_handleBlinkDevice)(DW1000Device *) = 0;
 void (*DW1000RangingClass::_handleNewDevice)(DW1000Device *) = 0;
 void (*DW1000RangingClass::_handleInactiveDevice)(DW1000Device *) = 0;
+void (*DW1000RangingClass::_handleLateTransmit)(byte, boolean) = 0;
 
 /* ###########################################################################
  * #### Init and end #######################################################
@@ -112,11 +151,27 @@ void DW1000RangingClass::configureNetwork(uint16_t deviceAddress, uint16_t netwo
 	DW1000.commitConfiguration();
 }
 
+void DW1000RangingClass::configureFrameFilter(boolean blinks)
+{
+	// all other messages are data frames to our short or long address or broadcast (POLL, RANGE),
+	// BLINKs are of frame type 5
+	DW1000.newConfiguration();
+	DW1000.setFrameFilter(_useFrameFilter);
+	DW1000.setFrameFilterAllowData(true);
+	DW1000.setFrameFilterAllowType5(blinks);
+	DW1000.commitConfiguration();
+}
+
 void DW1000RangingClass::generalStart()
 {
+	// our addresses are in the messages
+	invalidateTemplates();
+	resetLateness();
 	// attach callback for (successfully) sent and received messages
 	DW1000.attachSentHandler(handleSent);
 	DW1000.attachReceivedHandler(handleReceived);
+	// and for reply windows which closed without a reply
+	DW1000.attachReceiveTimeoutHandler(handleReceiveTimeout);
 	// anchor starts in receiving mode, awaiting a ranging poll message
 
 	if (DEBUG)
@@ -150,7 +205,7 @@ void DW1000RangingClass::generalStart()
 	// anchor starts in receiving mode, awaiting a ranging poll message
 	receiver();
 	// for first time ranging frequency computation
-	_rangingCountPeriod = millis();
+	_rangingCountPeriod = DW1000Hal::millis();
 }
 
 void DW1000RangingClass::startAsAnchor(char address[], const byte mode[], const bool randomShortAddress)
@@ -178,6 +233,8 @@ void DW1000RangingClass::startAsAnchor(char address[], const byte mode[], const
 	//we configur the network for mac filtering
 	//(device Address, network ID, frequency)
 	DW1000Ranging.configureNetwork(_currentShortAddress[0] * 256 + _currentShortAddress[1], 0xDECA, mode);
+	//anchors take BLINKs of tags not known yet
+	configureFrameFilter(true);
 
 	//general start:
 	generalStart();
@@ -213,6 +270,7 @@ void DW1000RangingClass::startAsTag(char address[], const byte mode[], const boo
 	//we configur the network for mac filtering
 	//(device Address, network ID, frequency)
 	DW1000Ranging.configureNetwork(_currentShortAddress[0] * 256 + _currentShortAddress[1], 0xDECA, mode);
+	configureFrameFilter(false);
 
 	generalStart();
 	//defined type as tag
@@ -245,9 +303,10 @@ boolean DW1000RangingClass::addNetworkDevices(DW1000Device *device, boolean shor
 	if (addDevice)
 	{
 		device->setRange(0);
-		memcpy(&_networkDevices[_networkDevicesNumber], device, sizeof(DW1000Device));
+		_networkDevices[_networkDevicesNumber] = *device;
 		_networkDevices[_networkDevicesNumber].setIndex(_networkDevicesNumber);
 		_networkDevicesNumber++;
+		invalidateTemplates();
 		return true;
 	}
 
@@ -275,9 +334,10 @@ boolean DW1000RangingClass::addNetworkDevices(DW1000Device *device)
 		{
 			_networkDevicesNumber = 0;
 		}
-		memcpy(&_networkDevices[_networkDevicesNumber], device, sizeof(DW1000Device));
+		_networkDevices[_networkDevicesNumber] = *device;
 		_networkDevices[_networkDevicesNumber].setIndex(_networkDevicesNumber);
 		_networkDevicesNumber++;
+		invalidateTemplates();
 		return true;
 	}
 
@@ -300,11 +360,12 @@ void DW1000RangingClass::removeNetworkDevices(int16_t index)
 		//we translate all the element wich are after the one we want to delete.
 		for (int16_t i = index; i < _networkDevicesNumber - 1; i++)
 		{ // TODO 8bit?
-			memcpy(&_networkDevices[i], &_networkDevices[i + 1], sizeof(DW1000Device));
+			_networkDevices[i] = _networkDevices[i + 1];
 			_networkDevices[i].setIndex(i);
 		}
 		_networkDevicesNumber--;
 	}
+	invalidateTemplates();
 }
 
 /* ###########################################################################
@@ -316,6 +377,10 @@ void DW1000RangingClass::setReplyTime(uint16_t replyDelayTimeUs) { _replyDelayTi
 
 void DW1000RangingClass::setResetPeriod(uint32_t resetPeriod) { _resetPeriod = resetPeriod; }
 
+void DW1000RangingClass::setReceiveWindowGuard(uint16_t guardUs) { _rxWindowGuardUS = (guardUs < MAX_RX_WINDOW_GUARD ? guardUs : MAX_RX_WINDOW_GUARD); }
+
+void DW1000RangingClass::setTransmitMargin(uint16_t marginUs) { _txMarginUS = marginUs; }
+
 DW1000Device *DW1000RangingClass::searchDistantDevice(byte shortAddress[])
 {
 	//we compare the 2 bytes address with the others
@@ -344,7 +409,9 @@ DW1000Device *DW1000RangingClass::getDistantDevice()
 
 void DW1000RangingClass::checkForReset()
 {
-	uint32_t curMillis = millis();
+	// a reply window which timed out ends the exchange long before the reset period
+	checkReceiveWindow();
+	uint32_t curMillis = DW1000Hal::millis();
 	if (!_sentAck && !_receivedAck)
 	{
 		// check if inactive
@@ -372,7 +439,7 @@ void DW1000RangingClass::checkForInactiveDevices()
 	}
 }
 
-// TODO check return type
+// -1 for frames which are no ranging messages
 int16_t DW1000RangingClass::detectMessageType(byte datas[])
 {
 	if (datas[0] == FC_1_BLINK)
@@ -389,13 +456,20 @@ int16_t DW1000RangingClass::detectMessageType(byte datas[])
 		//we have a short mac frame message (poll, range, range report, etc..)
 		return datas[SHORT_MAC_LEN];
 	}
+	return -1;
 }
 
 void DW1000RangingClass::loop()
 {
+	// service a DW1000 without interrupt line, and one deferred event per loop (if enabled) so the
+	// flags below never merge two events
+	DW1000.poll();
+	DW1000.process(1);
 	//we check if needed to reset !
 	checkForReset();
-	uint32_t now_time = millis(); // TODO other name - too close to "timer"
+	// frames queued behind the last one go out once its sent event was handled
+	startQueued();
+	uint32_t now_time = DW1000Hal::millis(); // TODO other name - too close to "timer"
 	if (now_time - last_time > _timerDelay)
 	{
 		last_time = now_time;
@@ -406,8 +480,11 @@ void DW1000RangingClass::loop()
 	{
 		_sentAck = false;
 
-		// TODO cc
-		int messageType = detectMessageType(data);
+		// the first queued frame went out
+		int messageType = sentQueued();
+
+		// the receiver only comes back on for what is expected next
+		listenForReply(messageType);
 
 		if (messageType != POLL_ACK && messageType != POLL && messageType != RANGE)
 			return;
@@ -485,7 +562,7 @@ void DW1000RangingClass::loop()
 
 		//we read the datas from the modules:
 		// get message and parse
-		DW1000.getData(data, LEN_DATA);
+		readData();
 
 		int messageType = detectMessageType(data);
 
@@ -583,6 +660,8 @@ void DW1000RangingClass::loop()
 							memcpy(&replyTime, data + SHORT_MAC_LEN + 2 + i * 4 + 2, 2);
 							//we configure our replyTime;
 							_replyDelayTimeUS = replyTime;
+							// the tag sends RANGE a reply time after the last POLL_ACK, i.e. the slots behind ours
+							_rxWindowReplyUS = (uint32_t)(2 * (numberDevices - i) - 1) * DEFAULT_REPLY_DELAY_TIME;
 
 							// on POLL we (re-)start, so no protocol failure
 							_protocolFailed = false;
@@ -683,6 +762,8 @@ void DW1000RangingClass::loop()
 				if (messageType == POLL_ACK)
 				{
 					DW1000.getReceiveTimestamp(myDistantDevice->timePollAckReceived);
+					nextReplyWindow(myDistantDevice->timePollAckReceived);
+					_pollAckReceived[myDistantDevice->getIndex()] = true;
 					//we note activity for our device:
 					myDistantDevice->noteActivity();
 
@@ -696,6 +777,9 @@ void DW1000RangingClass::loop()
 				}
 				else if (messageType == RANGE_REPORT)
 				{
+					DW1000Time timeRangeReportReceived;
+					DW1000.getReceiveTimestamp(timeRangeReportReceived);
+					nextReplyWindow(timeRangeReportReceived);
 
 					float curRange;
 					memcpy(&curRange, data + 1 + SHORT_MAC_LEN, 4);
@@ -736,9 +820,15 @@ void DW1000RangingClass::loop()
 
 void DW1000RangingClass::loopwoReport()
 {
+	// service a DW1000 without interrupt line, and one deferred event per loop (if enabled) so the
+	// flags below never merge two events
+	DW1000.poll();
+	DW1000.process(1);
 	//we check if needed to reset !
 	checkForReset();
-	uint32_t now_time = millis(); // TODO other name - too close to "timer"
+	// frames queued behind the last one go out once its sent event was handled
+	startQueued();
+	uint32_t now_time = DW1000Hal::millis(); // TODO other name - too close to "timer"
 	if (now_time - last_time > _timerDelay)
 	{
 		last_time = now_time;
@@ -749,8 +839,11 @@ void DW1000RangingClass::loopwoReport()
 	{
 		_sentAck = false;
 
-		// TODO cc
-		int messageType = detectMessageType(data);
+		// the first queued frame went out
+		int messageType = sentQueued();
+
+		// the receiver only comes back on for what is expected next
+		listenForReply(messageType);
 
 		if (messageType != POLL_ACK && messageType != POLL && messageType != RANGE)
 			return;
@@ -828,7 +921,7 @@ void DW1000RangingClass::loopwoReport()
 
 		//we read the datas from the modules:
 		// get message and parse
-		DW1000.getData(data, LEN_DATA);
+		readData();
 
 		int messageType = detectMessageType(data);
 
@@ -926,6 +1019,8 @@ void DW1000RangingClass::loopwoReport()
 							memcpy(&replyTime, data + SHORT_MAC_LEN + 2 + i * 4 + 2, 2);
 							//we configure our replyTime;
 							_replyDelayTimeUS = replyTime;
+							// the tag sends RANGE a reply time after the last POLL_ACK, i.e. the slots behind ours
+							_rxWindowReplyUS = (uint32_t)(2 * (numberDevices - i) - 1) * DEFAULT_REPLY_DELAY_TIME;
 
 							// on POLL we (re-)start, so no protocol failure
 							_protocolFailed = false;
@@ -1026,6 +1121,8 @@ void DW1000RangingClass::loopwoReport()
 				if (messageType == POLL_ACK)
 				{
 					DW1000.getReceiveTimestamp(myDistantDevice->timePollAckReceived);
+					nextReplyWindow(myDistantDevice->timePollAckReceived);
+					_pollAckReceived[myDistantDevice->getIndex()] = true;
 					//we note activity for our device:
 					myDistantDevice->noteActivity();
 
@@ -1051,9 +1148,15 @@ void DW1000RangingClass::loopwoReport()
 static bool needToBlink_FLAG = true;
 void DW1000RangingClass::Tag_loop()
 {
+	// service a DW1000 without interrupt line, and one deferred event per loop (if enabled) so the
+	// flags below never merge two events
+	DW1000.poll();
+	DW1000.process(1);
 	//we check if needed to reset !
 	checkForReset();
-	uint32_t now_time = millis(); // TODO other name - too close to "timer"
+	// frames queued behind the last one go out once its sent event was handled
+	startQueued();
+	uint32_t now_time = DW1000Hal::millis(); // TODO other name - too close to "timer"
 	if (now_time - last_time > _timerDelay)
 	{
 		last_time = now_time;
@@ -1088,8 +1191,11 @@ void DW1000RangingClass::Tag_loop()
 	{
 		_sentAck = false;
 
-		// TODO cc
-		int messageType = detectMessageType(data);
+		// the first queued frame went out
+		int messageType = sentQueued();
+
+		// the receiver only comes back on for what is expected next
+		listenForReply(messageType);
 
 		if (messageType != POLL_ACK && messageType != POLL && messageType != RANGE)
 			return;
@@ -1155,7 +1261,7 @@ void DW1000RangingClass::Tag_loop()
 
 		//we read the datas from the modules:
 		// get message and parse
-		DW1000.getData(data, LEN_DATA);
+		readData();
 
 		int messageType = detectMessageType(data);
 
@@ -1222,6 +1328,8 @@ void DW1000RangingClass::Tag_loop()
 				{
 					Serial.println("7_GET_POLLACK");
 					DW1000.getReceiveTimestamp(myDistantDevice->timePollAckReceived);
+					nextReplyWindow(myDistantDevice->timePollAckReceived);
+					_pollAckReceived[myDistantDevice->getIndex()] = true;
 					//we note activity for our device:
 					myDistantDevice->noteActivity();
 
@@ -1234,7 +1342,7 @@ void DW1000RangingClass::Tag_loop()
 						//transmitRange(myDistantDevice);
 						Serial.println("8_SEND_RANGE");
 						needToBlink_FLAG = false;
-						delay(_networkDevicesNumber*DEFAULT_TIMER_DELAY);
+						DW1000Hal::delay(_networkDevicesNumber*DEFAULT_TIMER_DELAY);
 						//send a prodcast poll
 						Serial.println("4_SNED_POLL");
 						transmitPoll(nullptr);
@@ -1254,9 +1362,15 @@ void DW1000RangingClass::Tag_loop()
 
 void DW1000RangingClass::Anchor_loop()
 {
+	// service a DW1000 without interrupt line, and one deferred event per loop (if enabled) so the
+	// flags below never merge two events
+	DW1000.poll();
+	DW1000.process(1);
 	//we check if needed to reset !
 	checkForReset();
-	uint32_t now_time = millis(); // TODO other name - too close to "timer"
+	// frames queued behind the last one go out once its sent event was handled
+	startQueued();
+	uint32_t now_time = DW1000Hal::millis(); // TODO other name - too close to "timer"
 	if (now_time - last_time > _timerDelay)
 	{
 		last_time = now_time;
@@ -1277,8 +1391,11 @@ void DW1000RangingClass::Anchor_loop()
 	{
 		_sentAck = false;
 
-		// TODO cc
-		int messageType = detectMessageType(data);
+		// the first queued frame went out
+		int messageType = sentQueued();
+
+		// the receiver only comes back on for what is expected next
+		listenForReply(messageType);
 
 		if (messageType != POLL_ACK && messageType != POLL && messageType != RANGE)
 			return;
@@ -1305,7 +1422,7 @@ void DW1000RangingClass::Anchor_loop()
 
 		//we read the datas from the modules:
 		// get message and parse
-		DW1000.getData(data, LEN_DATA);
+		readData();
 
 		int messageType = detectMessageType(data);
 
@@ -1393,6 +1510,8 @@ void DW1000RangingClass::Anchor_loop()
 
 							// it will broadcast the anchor need to delay but why collions?
 							_replyDelayTimeUS = replyTime;
+							// the tag sends RANGE a reply time after the last POLL_ACK, i.e. the slots behind ours
+							_rxWindowReplyUS = (uint32_t)(2 * (numberDevices - i) - 1) * DEFAULT_REPLY_DELAY_TIME;
 
 							// on POLL we (re-)start, so no protocol failure
 							_protocolFailed = false;
@@ -1493,6 +1612,16 @@ void DW1000RangingClass::Anchor_loop()
 	}
 }
 
+void DW1000RangingClass::useFrameFilter(boolean enabled)
+{
+	_useFrameFilter = enabled;
+}
+
+void DW1000RangingClass::useSniffMode(boolean enabled)
+{
+	_useSniffMode = enabled;
+}
+
 void DW1000RangingClass::useRangeFilter(boolean enabled)
 {
 	_useRangeFilter = enabled;
@@ -1526,10 +1655,16 @@ void DW1000RangingClass::handleReceived()
 	_receivedAck = true;
 }
 
+void DW1000RangingClass::handleReceiveTimeout()
+{
+	// the reply window closed without a reply
+	_rxWindowClosed = true;
+}
+
 void DW1000RangingClass::noteActivity()
 {
 	// update activity timestamp, so that we do not reach "resetPeriod"
-	_lastActivity = millis();
+	_lastActivity = DW1000Hal::millis();
 }
 
 void DW1000RangingClass::resetInactive()
@@ -1582,28 +1717,349 @@ void DW1000RangingClass::copyShortAddress(byte address1[], byte address2[])
 
 void DW1000RangingClass::transmitInit()
 {
-	DW1000.newTransmit();
-	DW1000.setDefaults();
+	// the radio is left alone, another frame may be on air: the message is only queued
+	_txReplyUs = NO_REPLY_WINDOW;
+	_txTimed = false;
+}
+
+// only the n bytes of the message are sent, not the whole data buffer
+boolean DW1000RangingClass::transmit(byte datas[], uint16_t n, boolean fixed)
+{
+	return queueMessage((byte)detectMessageType(datas), _lastSentToShortAddress, datas, n, fixed, 0);
+}
+
+boolean DW1000RangingClass::transmit(byte datas[], uint16_t n, boolean fixed, DW1000Time time)
+{
+	scheduleTransmit(time);
+	return transmit(datas, n, fixed);
+}
+
+/*
+ * The message being built goes out a delay from now, the timestamp it gets is known before.
+ */
+DW1000Time DW1000RangingClass::scheduleTransmit(const DW1000Time& delay)
+{
+	DW1000.getSystemTimestamp(_txTime);
+	_txDue = DW1000Hal::micros() + (uint32_t)delay.getAsMicroSeconds();
+	_txTime += delay;
+	_txTimed = true;
+	return DW1000.getDelayedTimestamp(_txTime);
+}
+
+/*
+ * Messages stay in the transmit buffer of the chip, one slot per destination and message type. When
+ * the same message is sent again only the sequence number is written if the rest is fixed (same
+ * content as long as the network devices do not change), otherwise everything behind the frame control.
+ * Returns the slot, or TX_TEMPLATES if the message could not be written.
+ */
+uint8_t DW1000RangingClass::writeMessage(byte type, byte address[], byte datas[], uint16_t n, boolean fixed)
+{
+	uint8_t seq = (type == BLINK ? 1 : 2);
+	uint8_t slot = TX_TEMPLATES;
+	boolean resident = false;
+	for (uint8_t i = 0; i < TX_TEMPLATES; i++)
+	{
+		if (isQueued(i))
+		{
+			// waits to be sent, neither patched nor taken
+			continue;
+		}
+		if (type != DATA_FRAME && _txTemplateLength[i] == n && _txTemplateType[i] == type &&
+		    (type == BLINK || memcmp(_txTemplateAddress[i], address, 2) == 0))
+		{
+			slot = i;
+			resident = true;
+			break;
+		}
+		// otherwise a free or the least recently used slot is taken
+		if (slot == TX_TEMPLATES ||
+		    (_txTemplateLength[slot] != 0 && (_txTemplateLength[i] == 0 || _txTemplateUse[i] < _txTemplateUse[slot])))
+		{
+			slot = i;
+		}
+	}
+	uint16_t offset = slot * TX_TEMPLATE_SIZE;
+	if (resident)
+	{
+		if (!DW1000.writeData(offset + seq, datas + seq, fixed ? 1 : n - seq))
+		{
+			return TX_TEMPLATES;
+		}
+	}
+	else
+	{
+		if (!DW1000.writeData(offset, datas, n))
+		{
+			return TX_TEMPLATES;
+		}
+		_txTemplateType[slot] = type;
+		_txTemplateLength[slot] = n;
+		copyShortAddress(_txTemplateAddress[slot], address);
+	}
+	_txTemplateUse[slot] = ++_txTemplateClock;
+	return slot;
+}
+
+void DW1000RangingClass::invalidateTemplates()
+{
+	memset(_txTemplateLength, 0, sizeof(_txTemplateLength));
+}
+
+boolean DW1000RangingClass::isQueued(uint8_t slot)
+{
+	for (uint8_t i = 0; i < _txQueueCount; i++)
+	{
+		if (_txQueueSlot[(_txQueueHead + i) % TX_QUEUE_SIZE] == slot)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Frames are uploaded when queued, also while another one is on air, and started one after the other
+ * (see startQueued()), each with the reply window and send time it was built with. The handler is
+ * called from loop() (sent) or when the radio is turned to receive while the frame is on air (dropped).
+ */
+boolean DW1000RangingClass::queueMessage(byte type, byte address[], byte datas[], uint16_t n, boolean fixed, void (*handleDone)(boolean sent))
+{
+	if (_txQueueCount == TX_QUEUE_SIZE || n == 0 || n + 2 > LEN_UWB_FRAMES)
+	{
+		return false;
+	}
+	uint8_t slot = writeMessage(type, address, datas, n, fixed);
+	if (slot == TX_TEMPLATES)
+	{
+		return false;
+	}
+	uint8_t pos = _txQueueCount;
+	if (type != DATA_FRAME)
+	{
+		// protocol messages go ahead of frames of the sketch still waiting (see startQueued())
+		while (pos > (_txOnAir ? 1 : 0) && _txTemplateType[_txQueueSlot[(_txQueueHead + pos - 1) % TX_QUEUE_SIZE]] == DATA_FRAME)
+		{
+			uint8_t from = (_txQueueHead + pos - 1) % TX_QUEUE_SIZE;
+			uint8_t to = (_txQueueHead + pos) % TX_QUEUE_SIZE;
+			_txQueueSlot[to] = _txQueueSlot[from];
+			_txQueueLength[to] = _txQueueLength[from];
+			_txQueueReplyUs[to] = _txQueueReplyUs[from];
+			_txQueueTimed[to] = _txQueueTimed[from];
+			_txQueueTime[to] = _txQueueTime[from];
+			_txQueueDue[to] = _txQueueDue[from];
+			_txQueueHandler[to] = _txQueueHandler[from];
+			pos--;
+		}
+	}
+	uint8_t i = (_txQueueHead + pos) % TX_QUEUE_SIZE;
+	_txQueueSlot[i] = slot;
+	_txQueueLength[i] = n;
+	_txQueueReplyUs[i] = _txReplyUs;
+	_txQueueTimed[i] = _txTimed;
+	_txQueueTime[i] = _txTime;
+	_txQueueDue[i] = _txDue;
+	_txQueueHandler[i] = handleDone;
+	_txQueueCount++;
+	startQueued();
+	return true;
+}
+
+boolean DW1000RangingClass::queueFrame(byte datas[], uint16_t n, void (*handleDone)(boolean sent))
+{
+	transmitInit();
+	byte address[2] = {0xFF, 0xFF};
+	return queueMessage(DATA_FRAME, address, datas, n, false, handleDone);
 }
 
-void DW1000RangingClass::transmit(byte datas[])
+boolean DW1000RangingClass::queueFrame(byte datas[], uint16_t n, const DW1000Time& time, void (*handleDone)(boolean sent))
 {
-	DW1000.setData(datas, LEN_DATA);
-	DW1000.startTransmit();
+	transmitInit();
+	_txTime = time;
+	_txTimed = true;
+	// on the host clock, the difference as a signed 40 bit timer value
+	DW1000Time now;
+	DW1000.getSystemTimestamp(now);
+	int64_t ahead = (int64_t)((time.getTimestamp() - now.getTimestamp()) << 24) >> 24;
+	_txDue = DW1000Hal::micros() + (int32_t)(ahead * DW1000Time::TIME_RES);
+	byte address[2] = {0xFF, 0xFF};
+	return queueMessage(DATA_FRAME, address, datas, n, false, handleDone);
 }
 
-void DW1000RangingClass::transmit(byte datas[], DW1000Time time)
+void DW1000RangingClass::startQueued()
 {
-	DW1000.setDelay(time);
-	DW1000.setData(data, LEN_DATA);
-	DW1000.startTransmit();
+	while (!_txOnAir && _txQueueCount > 0)
+	{
+		uint8_t i = _txQueueHead;
+		byte type = _txTemplateType[_txQueueSlot[i]];
+		if (type == DATA_FRAME && _rxWindow && (_type == TAG ? _rxWindowSlots > 0 : _expectedMsgId == RANGE))
+		{
+			// frames of the sketch wait while a reply is due, they would close the reply window
+			return;
+		}
+		if (!DW1000.setDataOffset(_txQueueSlot[i] * TX_TEMPLATE_SIZE, _txQueueLength[i]))
+		{
+			// not sendable from the transmit buffer, the radio is left as it is
+			dropQueued();
+			if (type == POLL_ACK)
+			{
+				_expectedMsgId = POLL;
+			}
+			continue;
+		}
+		if (_txQueueTimed[i] && !checkLateness(i, type))
+		{
+			dropQueued();
+			if (type == POLL_ACK)
+			{
+				// no window for the RANGE, the tag starts over
+				_expectedMsgId = POLL;
+			}
+			continue;
+		}
+		DW1000.newTransmit();
+		DW1000.setDefaults();
+		if (_txQueueReplyUs[i] != NO_REPLY_WINDOW)
+		{
+			// the chip opens the window itself after the frame, counted from its end
+			configureWindow();
+			DW1000.setResponseDelay(_txQueueReplyUs[i]);
+			DW1000.waitForResponse(true);
+		}
+		else if (_rxWindow && _txQueueCount == 1)
+		{
+			// the last frame ends the exchange, the receiver listens continuously right after it
+			// instead of being restarted from the sent event (see listenForReply())
+			configureListening();
+		}
+		if (_txQueueTimed[i])
+		{
+			DW1000.setDelayedTime(_txQueueTime[i]);
+		}
+		// the chip listens right after the last frame of an exchange, no second SYS_CTRL write
+		DW1000.startTransmit(_rxWindow ? DW1000.TX_ONLY : DW1000.TX_THEN_RX);
+		_txOnAir = true;
+	}
+}
+
+/*
+ * A delayed frame started with less than the transmit margin and its preamble time left would miss its
+ * send time, and the chip would send it a timer period (about 17 s) later. Checked on the host clock, no SPI transfer.
+ * Frames which do not carry their send time (not RANGE) are moved to the earliest time the margin
+ * allows, protocol messages only as long as the reply still falls into the window of the other side.
+ */
+boolean DW1000RangingClass::checkLateness(uint8_t i, byte type)
+{
+	int32_t marginUs = (int32_t)(_txQueueDue[i] - DW1000Hal::micros());
+	uint8_t t = typeIndex(type);
+	_txDelayedCount[t]++;
+	if (marginUs < _txMinMarginUS[t])
+	{
+		_txMinMarginUS[t] = marginUs;
+	}
+	// the transmitter starts with the preamble, before the send time
+	int32_t neededUs = (int32_t)_txMarginUS + DW1000.getPreambleTime();
+	if (marginUs >= neededUs)
+	{
+		return true;
+	}
+	_txLateCount[t]++;
+	uint32_t shiftUs = (uint32_t)(neededUs - marginUs);
+	boolean rescheduled = (type == DATA_FRAME || (type != RANGE && shiftUs <= _rxWindowGuardUS));
+	if (rescheduled)
+	{
+		_txQueueTime[i] += DW1000Time(shiftUs, DW1000Time::MICROSECONDS);
+		_txQueueDue[i] += shiftUs;
+	}
+	if (_handleLateTransmit != 0)
+	{
+		(*_handleLateTransmit)(type, rescheduled);
+	}
+	return rescheduled;
+}
+
+void DW1000RangingClass::dropQueued()
+{
+	void (*handleDone)(boolean sent) = _txQueueHandler[_txQueueHead];
+	_txQueueHead = (_txQueueHead + 1) % TX_QUEUE_SIZE;
+	_txQueueCount--;
+	if (handleDone != 0)
+	{
+		(*handleDone)(false);
+	}
+}
+
+/*
+ * Called on the sent event: the first frame is done. Returns its message type and, for the protocol,
+ * restores its destination, frames may have been built since.
+ */
+int16_t DW1000RangingClass::sentQueued()
+{
+	if (!_txOnAir)
+	{
+		return -1;
+	}
+	uint8_t slot = _txQueueSlot[_txQueueHead];
+	void (*handleDone)(boolean sent) = _txQueueHandler[_txQueueHead];
+	int16_t messageType = _txTemplateType[slot];
+	if (messageType != DATA_FRAME)
+	{
+		copyShortAddress(_lastSentToShortAddress, _txTemplateAddress[slot]);
+	}
+	_txQueueHead = (_txQueueHead + 1) % TX_QUEUE_SIZE;
+	_txQueueCount--;
+	_txOnAir = false;
+	if (handleDone != 0)
+	{
+		(*handleDone)(true);
+	}
+	return messageType;
+}
+
+void DW1000RangingClass::abortQueued()
+{
+	// the radio was turned to receive, the frame on air is lost (those waiting are not)
+	if (_txOnAir)
+	{
+		_txOnAir = false;
+		dropQueued();
+	}
+}
+
+uint8_t DW1000RangingClass::typeIndex(byte messageType)
+{
+	return (messageType < MESSAGE_TYPES - 1 ? messageType : MESSAGE_TYPES - 1);
+}
+
+uint16_t DW1000RangingClass::getDelayedCount(byte messageType)
+{
+	return _txDelayedCount[typeIndex(messageType)];
+}
+
+uint16_t DW1000RangingClass::getLateCount(byte messageType)
+{
+	return _txLateCount[typeIndex(messageType)];
+}
+
+int32_t DW1000RangingClass::getMinMargin(byte messageType)
+{
+	return _txMinMarginUS[typeIndex(messageType)];
+}
+
+void DW1000RangingClass::resetLateness()
+{
+	for (uint8_t t = 0; t < MESSAGE_TYPES; t++)
+	{
+		_txDelayedCount[t] = 0;
+		_txLateCount[t] = 0;
+		_txMinMarginUS[t] = 0x7FFFFFFF;
+	}
 }
 
 void DW1000RangingClass::transmitBlink()
 {
 	transmitInit();
 	_globalMac.generateBlinkFrame(data, _currentAddress, _currentShortAddress);
-	transmit(data);
+	transmit(data, BLINK_LEN, true);
 }
 
 void DW1000RangingClass::transmitRangingInit(DW1000Device *myDistantDevice)
@@ -1616,13 +2072,16 @@ void DW1000RangingClass::transmitRangingInit(DW1000Device *myDistantDevice)
 
 	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
 
-	transmit(data);
+	transmit(data, LONG_MAC_LEN + 1, true);
 }
 
 void DW1000RangingClass::transmitPoll(DW1000Device *myDistantDevice)
 {
 
 	transmitInit();
+	replyWindow(DEFAULT_REPLY_DELAY_TIME);
+	memset(_pollAckReceived, 0, sizeof(_pollAckReceived));
+	uint16_t n;
 
 	if (myDistantDevice == nullptr)
 	{
@@ -1647,6 +2106,7 @@ void DW1000RangingClass::transmitPoll(DW1000Device *myDistantDevice)
 			memcpy(data + SHORT_MAC_LEN + 2 + 2 + 4 * i, &replyTime, 2);
 		}
 
+		n = SHORT_MAC_LEN + 2 + 4 * _networkDevicesNumber;
 		copyShortAddress(_lastSentToShortAddress, shortBroadcast);
 	}
 	else
@@ -1663,27 +2123,32 @@ void DW1000RangingClass::transmitPoll(DW1000Device *myDistantDevice)
 		uint16_t replyTime = myDistantDevice->getReplyTime();
 		memcpy(data + SHORT_MAC_LEN + 2 + 2 + 4 * 0, &replyTime, 2);
 
+		n = SHORT_MAC_LEN + 2 + 4;
 		copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
 	}
 
-	transmit(data);
+	transmit(data, n, true);
 }
 
 void DW1000RangingClass::transmitPollAck(DW1000Device *myDistantDevice)
 {
 	transmitInit();
+	// the RANGE is due when the tag's slot comes (see the POLL handling)
+	replyWindow(_rxWindowReplyUS);
 	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress());
 	data[SHORT_MAC_LEN] = POLL_ACK;
 	// delay the same amount as ranging tag
 	DW1000Time deltaTime = DW1000Time(_replyDelayTimeUS, DW1000Time::MICROSECONDS);
 	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
-	transmit(data, deltaTime);
+	transmit(data, SHORT_MAC_LEN + 1, true, deltaTime);
 }
 
-void DW1000RangingClass::transmitRange(DW1000Device *myDistantDevice)
+void DW1000RangingClass::transmitRange(DW1000Device *myDistantDevice, uint32_t replyTimeUs)
 {
 	//transmit range need to accept broadcast for multiple anchor
 	transmitInit();
+	replyWindow(DEFAULT_REPLY_DELAY_TIME);
+	uint16_t n;
 
 	if (myDistantDevice == nullptr)
 	{
@@ -1693,25 +2158,33 @@ void DW1000RangingClass::transmitRange(DW1000Device *myDistantDevice)
 		byte shortBroadcast[2] = {0xFF, 0xFF};
 		_globalMac.generateShortMACFrame(data, _currentShortAddress, shortBroadcast);
 		data[SHORT_MAC_LEN] = RANGE;
-		//we enter the number of devices
-		data[SHORT_MAC_LEN + 1] = _networkDevicesNumber;
 
 		// delay sending the message and remember expected future sent timestamp
-		DW1000Time deltaTime = DW1000Time(DEFAULT_REPLY_DELAY_TIME, DW1000Time::MICROSECONDS);
-		DW1000Time timeRangeSent = DW1000.setDelay(deltaTime);
+		DW1000Time deltaTime = DW1000Time(replyTimeUs, DW1000Time::MICROSECONDS);
+		DW1000Time timeRangeSent = scheduleTransmit(deltaTime);
 
+		// an anchor whose POLL_ACK was missed would range with the timestamps of an older round
+		uint8_t k = 0;
 		for (uint8_t i = 0; i < _networkDevicesNumber; i++)
 		{
+			if (!_pollAckReceived[i])
+			{
+				continue;
+			}
 			//we write the short address of our device:
-			memcpy(data + SHORT_MAC_LEN + 2 + 17 * i, _networkDevices[i].getByteShortAddress(), 2);
+			memcpy(data + SHORT_MAC_LEN + 2 + 17 * k, _networkDevices[i].getByteShortAddress(), 2);
 
 			//we get the device which correspond to the message which was sent (need to be filtered by MAC address)
 			_networkDevices[i].timeRangeSent = timeRangeSent;
-			_networkDevices[i].timePollSent.getTimestamp(data + SHORT_MAC_LEN + 4 + 17 * i);
-			_networkDevices[i].timePollAckReceived.getTimestamp(data + SHORT_MAC_LEN + 9 + 17 * i);
-			_networkDevices[i].timeRangeSent.getTimestamp(data + SHORT_MAC_LEN + 14 + 17 * i);
+			_networkDevices[i].timePollSent.getTimestamp(data + SHORT_MAC_LEN + 4 + 17 * k);
+			_networkDevices[i].timePollAckReceived.getTimestamp(data + SHORT_MAC_LEN + 9 + 17 * k);
+			_networkDevices[i].timeRangeSent.getTimestamp(data + SHORT_MAC_LEN + 14 + 17 * k);
+			k++;
 		}
+		//we enter the number of devices
+		data[SHORT_MAC_LEN + 1] = k;
 
+		n = SHORT_MAC_LEN + 2 + 17 * k;
 		copyShortAddress(_lastSentToShortAddress, shortBroadcast);
 	}
 	else
@@ -1721,14 +2194,15 @@ void DW1000RangingClass::transmitRange(DW1000Device *myDistantDevice)
 		// delay sending the message and remember expected future sent timestamp
 		DW1000Time deltaTime = DW1000Time(_replyDelayTimeUS, DW1000Time::MICROSECONDS);
 		//we get the device which correspond to the message which was sent (need to be filtered by MAC address)
-		myDistantDevice->timeRangeSent = DW1000.setDelay(deltaTime);
+		myDistantDevice->timeRangeSent = scheduleTransmit(deltaTime);
 		myDistantDevice->timePollSent.getTimestamp(data + 1 + SHORT_MAC_LEN);
 		myDistantDevice->timePollAckReceived.getTimestamp(data + 6 + SHORT_MAC_LEN);
 		myDistantDevice->timeRangeSent.getTimestamp(data + 11 + SHORT_MAC_LEN);
+		n = SHORT_MAC_LEN + 16;
 		copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
 	}
 
-	transmit(data);
+	transmit(data, n, false);
 }
 
 void DW1000RangingClass::transmitRangeReport(DW1000Device *myDistantDevice)
@@ -1743,7 +2217,7 @@ void DW1000RangingClass::transmitRangeReport(DW1000Device *myDistantDevice)
 	memcpy(data + 1 + SHORT_MAC_LEN, &curRange, 4);
 	memcpy(data + 5 + SHORT_MAC_LEN, &curRXPower, 4);
 	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
-	transmit(data, DW1000Time(_replyDelayTimeUS, DW1000Time::MICROSECONDS));
+	transmit(data, SHORT_MAC_LEN + 9, false, DW1000Time(_replyDelayTimeUS, DW1000Time::MICROSECONDS));
 }
 
 void DW1000RangingClass::transmitRangeFailed(DW1000Device *myDistantDevice)
@@ -1753,16 +2227,165 @@ void DW1000RangingClass::transmitRangeFailed(DW1000Device *myDistantDevice)
 	data[SHORT_MAC_LEN] = RANGE_FAILED;
 
 	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
-	transmit(data);
+	transmit(data, SHORT_MAC_LEN + 1, true);
+}
+
+// reads only the received bytes, the rest of the buffer is cleared so nothing of a longer, older message remains
+uint16_t DW1000RangingClass::readData()
+{
+	uint16_t n = DW1000.getDataLength();
+	if (n > LEN_DATA)
+	{
+		n = LEN_DATA;
+	}
+	DW1000.getData(data, n);
+	memset(data + n, 0, LEN_DATA - n);
+	return n;
 }
 
 void DW1000RangingClass::receiver()
 {
 	DW1000.newReceive();
 	DW1000.setDefaults();
+	configureListening();
+	DW1000.startReceive();
+	abortQueued();
+}
+
+void DW1000RangingClass::configureListening()
+{
 	// so we don't need to restart the receiver manually
 	DW1000.receivePermanently(true);
+	// and not only within a reply window
+	DW1000.setReceiveTimeout(0);
+	DW1000.setPreambleDetectTimeout(0);
+	// maybe at a fraction of the receiver current, no reply is due
+	DW1000.useSniffMode(_useSniffMode);
+	_rxWindow = false;
+}
+
+void DW1000RangingClass::configureWindow()
+{
+	// a tag takes one reply per window, an anchor keeps listening until its window times out
+	DW1000.receivePermanently(_type == ANCHOR);
+	// but goes on listening after frames of others (filtered) or failed ones, committed with the timeout
+	DW1000.setReceiverAutoReenable(true);
+	// closed if no preamble started within the guard time after the reply was due (a frame fits in a reply time)
+	DW1000.setPreambleDetectTimeout(2 * _rxWindowGuardUS);
+	DW1000.setReceiveTimeout(2 * _rxWindowGuardUS + DEFAULT_REPLY_DELAY_TIME);
+	DW1000.useSniffMode(false);
+	_rxWindow = true;
+}
+
+void DW1000RangingClass::receiveWindow(uint32_t replyTimeUs)
+{
+	DW1000.newReceive();
+	DW1000.setDefaults();
+	configureWindow();
+	if (replyTimeUs > _rxWindowGuardUS)
+	{
+		DW1000.setDelay(DW1000Time(replyTimeUs - _rxWindowGuardUS, DW1000Time::MICROSECONDS));
+	}
 	DW1000.startReceive();
+	abortQueued();
+}
+
+void DW1000RangingClass::replyWindow(uint32_t replyTimeUs)
+{
+	if (_rxWindowGuardUS == 0)
+	{
+		// listening continuously
+		return;
+	}
+	// for the message being built, opened by the chip after the frame (see startQueued())
+	_txReplyUs = (replyTimeUs > _rxWindowGuardUS ? replyTimeUs - _rxWindowGuardUS : 0);
+}
+
+void DW1000RangingClass::listenForReply(int16_t messageType)
+{
+	if (_rxWindowGuardUS == 0)
+	{
+		// listening continuously
+		return;
+	}
+	if (_type == TAG && (messageType == POLL || messageType == RANGE))
+	{
+		// anchor i replies (2i+1) reply times after a POLL or RANGE was sent (see transmitPoll()),
+		// the window for the first one opened with the frame (see replyWindow())
+		boolean broadcast = (_lastSentToShortAddress[0] == 0xFF && _lastSentToShortAddress[1] == 0xFF);
+		_rxWindowSlots = (broadcast ? _networkDevicesNumber : 1);
+	}
+	else if (_type == ANCHOR && messageType == POLL_ACK)
+	{
+		// opened with the frame as well
+	}
+	else if (_rxWindow && _txQueueCount == 0)
+	{
+		// a BLINK is answered at any time, anything else ends the exchange (once the queue is empty,
+		// each queued frame takes the radio anyway and comes back here); usually the receiver is on
+		// already, set up with the last frame (see startQueued())
+		receiver();
+	}
+}
+
+void DW1000RangingClass::nextReplyWindow(const DW1000Time& lastReply)
+{
+	if (!_rxWindow || _rxWindowSlots <= 1)
+	{
+		_rxWindowSlots = 0;
+		return;
+	}
+	_rxWindowSlots--;
+	// the next anchor replies two reply times after the last one started to, not after it was received
+	DW1000Time now;
+	DW1000.getSystemTimestamp(now);
+	double dueUs = 2.0 * DEFAULT_REPLY_DELAY_TIME - (now - lastReply).wrap().getAsMicroSeconds();
+	receiveWindow(dueUs > 0 ? (uint32_t)dueUs : 0);
+}
+
+void DW1000RangingClass::checkReceiveWindow()
+{
+	if (!_rxWindowClosed)
+	{
+		return;
+	}
+	_rxWindowClosed = false;
+	if (!_rxWindow)
+	{
+		return;
+	}
+	if (_type == ANCHOR)
+	{
+		// no RANGE, the tag gave up or lost our POLL_ACK
+		_expectedMsgId = POLL;
+		receiver();
+	}
+	else if (_rxWindowSlots > 1)
+	{
+		// this anchor did not reply, the next one is due two reply times after it (and the window
+		// closed a guard time after it was due)
+		_rxWindowSlots--;
+		receiveWindow(2 * DEFAULT_REPLY_DELAY_TIME > _rxWindowGuardUS ? 2 * DEFAULT_REPLY_DELAY_TIME - _rxWindowGuardUS : 0);
+	}
+	else
+	{
+		_rxWindowSlots = 0;
+		if (_expectedMsgId != POLL_ACK)
+		{
+			return;
+		}
+		for (uint8_t i = 0; i < _networkDevicesNumber; i++)
+		{
+			if (_pollAckReceived[i])
+			{
+				// the last anchor did not reply, the others get their RANGE when it would have followed
+				// its POLL_ACK (due a guard time before the window closed)
+				_expectedMsgId = RANGE_REPORT;
+				transmitRange(nullptr, DEFAULT_REPLY_DELAY_TIME > _rxWindowGuardUS ? DEFAULT_REPLY_DELAY_TIME - _rxWindowGuardUS : 0);
+				return;
+			}
+		}
+	}
 }
 
 /* ###########################################################################
@@ -39,9 +39,21 @@
 #define RANGE_FAILED 255
 #define BLINK 4
 #define RANGING_INIT 5
+// frames queued by the sketch (see queueFrame()), not part of the protocol
+#define DATA_FRAME 6
 
 #define LEN_DATA 90
 
+//messages kept in the transmit buffer of the chip, each in a slot of its own (the buffer belongs to DW1000Ranging)
+#define TX_TEMPLATES 8
+#define TX_TEMPLATE_SIZE (LEN_TX_BUFFER / TX_TEMPLATES)
+//frames waiting to be sent, the one on air included (each keeps its slot until then, so fewer than TX_TEMPLATES)
+#define TX_QUEUE_SIZE 4
+//no reply window after the frame
+#define NO_REPLY_WINDOW 0xFFFFFFFF
+//message types with lateness statistics (RANGE_FAILED counted last)
+#define MESSAGE_TYPES 8
+
 //Max devices we put in the networkDevices array ! Each DW1000Device is 74 Bytes in SRAM memory for now.
 #define MAX_DEVICES 4
 
@@ -54,6 +66,12 @@
 #define DEFAULT_RESET_PERIOD 250
 //in us
 #define DEFAULT_REPLY_DELAY_TIME 8000
+//in us, the receiver turns on this long before a reply is due, and off if none started this long after
+#define DEFAULT_RX_WINDOW_GUARD 2000
+//in us, the receive timeout of a window (two guard times and a reply time) has to fit in 16 bit
+#define MAX_RX_WINDOW_GUARD ((0xFFFF - DEFAULT_REPLY_DELAY_TIME) / 2)
+//in us, a delayed frame is started at least this long before its send time (SPI transfers of the start)
+#define DEFAULT_TX_MARGIN 500
 
 //sketch type (anchor or tag)
 #define TAG 0
@@ -87,6 +105,28 @@ public:
 	//setters
 	static void setReplyTime(uint16_t replyDelayTimeUs);
 	static void setResetPeriod(uint32_t resetPeriod);
+	// Listen for replies only around the time they are due, 0 to listen continuously. Limited to MAX_RX_WINDOW_GUARD. Default DEFAULT_RX_WINDOW_GUARD.
+	static void setReceiveWindowGuard(uint16_t guardUs);
+	// A delayed frame is late if less than this and its preamble time (see DW1000Class::getPreambleTime()) is left before its send time when it is started. It is then sent as soon as the margin allows if it does not carry its send time and the reply still falls into the window of the other side (guard time), frames of the sketch always; dropped otherwise. Default DEFAULT_TX_MARGIN.
+	static void setTransmitMargin(uint16_t marginUs);
+	// Filter frames in the chip: only BLINKs (anchor) and frames to this device or broadcast wake the host. Call before startAs*(). Default true.
+	static void useFrameFilter(boolean enabled);
+	// Listen in preamble sniff mode while waiting for an exchange (not within reply windows), see DW1000Class::useSniffMode(). Default false.
+	static void useSniffMode(boolean enabled);
+	
+	//transmit queue
+	// Sends a frame (without checksum, up to 125 bytes) after the ones queued before, from loop(), without waiting for the radio. Waits while a ranging reply is due and gives way to protocol messages. handleDone learns whether it was sent (false: dropped, the protocol turned the radio to receive while it was on air). false if the queue is full.
+	static boolean queueFrame(byte datas[], uint16_t n, void (* handleDone)(boolean sent) = 0);
+	// The same at a system time (see DW1000Class::setDelayedTime()), e.g. a reply delay after a received timestamp.
+	static boolean queueFrame(byte datas[], uint16_t n, const DW1000Time& time, void (* handleDone)(boolean sent) = 0);
+	
+	//late transmissions (see setTransmitMargin()), per message type (POLL_ACK, RANGE, RANGE_REPORT, DATA_FRAME, ...)
+	// Delayed frames started and late ones among them (moved or dropped).
+	static uint16_t getDelayedCount(byte messageType);
+	static uint16_t getLateCount(byte messageType);
+	// Smallest time left before the send time of a delayed frame when it was started [us], negative if too late. The processing latency is the reply time minus this.
+	static int32_t  getMinMargin(byte messageType);
+	static void     resetLateness();
 	
 	//getters
 	static byte* getCurrentAddress() { return _currentAddress; };
@@ -114,6 +154,9 @@ public:
 	
 	static void attachInactiveDevice(void (* handleInactiveDevice)(DW1000Device*)) { _handleInactiveDevice = handleInactiveDevice; };
 	
+	// a delayed frame was late, moved to a later send time (rescheduled) or dropped
+	static void attachLateTransmit(void (* handleLateTransmit)(byte messageType, boolean rescheduled)) { _handleLateTransmit = handleLateTransmit; };
+	
 	
 	
 	static DW1000Device* getDistantDevice();
@@ -131,6 +174,33 @@ public:
 	static byte         _currentAddress[8];
 	static byte         _currentShortAddress[2];
 	static byte         _lastSentToShortAddress[2];
+	// messages in the transmit buffer, per destination and message type (length 0 for a free slot)
+	static byte         _txTemplateAddress[TX_TEMPLATES][2];
+	static byte         _txTemplateType[TX_TEMPLATES];
+	static uint8_t      _txTemplateLength[TX_TEMPLATES];
+	static uint16_t     _txTemplateUse[TX_TEMPLATES];
+	static uint16_t     _txTemplateClock;
+	// transmit queue (ring), frames wait in their template slot, the first one is on air if _txOnAir
+	static uint8_t      _txQueueSlot[TX_QUEUE_SIZE];
+	static uint8_t      _txQueueLength[TX_QUEUE_SIZE];
+	static uint32_t     _txQueueReplyUs[TX_QUEUE_SIZE];
+	static boolean      _txQueueTimed[TX_QUEUE_SIZE];
+	static DW1000Time   _txQueueTime[TX_QUEUE_SIZE];
+	static uint32_t     _txQueueDue[TX_QUEUE_SIZE]; // send time on the host clock (micros())
+	static void       (* _txQueueHandler[TX_QUEUE_SIZE])(boolean sent);
+	static uint8_t      _txQueueHead;
+	static uint8_t      _txQueueCount;
+	static boolean      _txOnAir;
+	// reply window and send time of the frame being built (see transmitInit())
+	static uint32_t     _txReplyUs;
+	static boolean      _txTimed;
+	static DW1000Time   _txTime;
+	static uint32_t     _txDue;
+	// late transmissions
+	static uint16_t     _txMarginUS;
+	static uint16_t     _txDelayedCount[MESSAGE_TYPES];
+	static uint16_t     _txLateCount[MESSAGE_TYPES];
+	static int32_t      _txMinMarginUS[MESSAGE_TYPES];
 	static DW1000Mac    _globalMac;
 	static int32_t      last_time;
 	static int16_t      counterForBlink;
@@ -140,6 +210,7 @@ public:
 	static void (* _handleBlinkDevice)(DW1000Device*);
 	static void (* _handleNewDevice)(DW1000Device*);
 	static void (* _handleInactiveDevice)(DW1000Device*);
+	static void (* _handleLateTransmit)(byte, boolean);
 	
 	//sketch type (tag or anchor)
 	static int16_t          _type; //0 for tag and 1 for anchor
@@ -159,11 +230,24 @@ public:
 	static uint32_t    _resetPeriod;
 	// reply times (same on both sides for symm. ranging)
 	static uint16_t     _replyDelayTimeUS;
+	// reply windows: the receiver is in one (not listening continuously), replies still due in it
+	// (tag) or when the reply is due (anchor), closed by a timeout
+	static uint16_t         _rxWindowGuardUS;
+	static boolean          _rxWindow;
+	static uint8_t          _rxWindowSlots;
+	// tag: anchors which answered the last POLL, only they are in the RANGE
+	static boolean          _pollAckReceived[MAX_DEVICES];
+	static uint32_t         _rxWindowReplyUS;
+	static volatile boolean _rxWindowClosed;
 	//timer Tick delay
 	static uint16_t     _timerDelay;
 	// ranging counter (per second)
 	static uint16_t     _successRangingCount;
 	static uint32_t    _rangingCountPeriod;
+	// hardware frame filtering
+	static boolean          _useFrameFilter;
+	// preamble sniff mode while idle
+	static boolean          _useSniffMode;
 	//ranging filter
 	static volatile boolean _useRangeFilter;
 	static uint16_t         _rangeFilterValue;
@@ -178,6 +262,7 @@ public:
 	//methods
 	static void handleSent();
 	static void handleReceived();
+	static void handleReceiveTimeout();
 	static void noteActivity();
 	static void resetInactive();
 	
@@ -185,21 +270,42 @@ public:
 	static void checkForReset();
 	static void checkForInactiveDevices();
 	static void copyShortAddress(byte address1[], byte address2[]);
+	static void configureFrameFilter(boolean blinks);
 	
 	//for ranging protocole (ANCHOR)
 	static void transmitInit();
-	static void transmit(byte datas[]);
-	static void transmit(byte datas[], DW1000Time time);
+	static boolean transmit(byte datas[], uint16_t n, boolean fixed);
+	static boolean transmit(byte datas[], uint16_t n, boolean fixed, DW1000Time time);
+	static DW1000Time scheduleTransmit(const DW1000Time& delay);
+	static uint8_t writeMessage(byte type, byte address[], byte datas[], uint16_t n, boolean fixed);
+	static void invalidateTemplates();
+	static boolean isQueued(uint8_t slot);
+	static boolean queueMessage(byte type, byte address[], byte datas[], uint16_t n, boolean fixed, void (* handleDone)(boolean sent));
+	static void startQueued();
+	static boolean checkLateness(uint8_t i, byte type);
+	static void dropQueued();
+	static int16_t sentQueued();
+	static void abortQueued();
+	static uint8_t typeIndex(byte messageType);
 	static void transmitBlink();
 	static void transmitRangingInit(DW1000Device* myDistantDevice);
 	static void transmitPollAck(DW1000Device* myDistantDevice);
 	static void transmitRangeReport(DW1000Device* myDistantDevice);
 	static void transmitRangeFailed(DW1000Device* myDistantDevice);
+	static uint16_t readData();
 	static void receiver();
+	static void configureListening();
+	static void configureWindow();
+	static void receiveWindow(uint32_t replyTimeUs);
+	static void replyWindow(uint32_t replyTimeUs);
+	static void listenForReply(int16_t messageType);
+	static void nextReplyWindow(const DW1000Time& lastReply);
+	static void checkReceiveWindow();
 	
 	//for ranging protocole (TAG)
 	static void transmitPoll(DW1000Device* myDistantDevice);
-	static void transmitRange(DW1000Device* myDistantDevice);
+	// replyTimeUs: delay of the broadcast RANGE, a unicast one follows the reply time of the anchor
+	static void transmitRange(DW1000Device* myDistantDevice, uint32_t replyTimeUs = DEFAULT_REPLY_DELAY_TIME);
 	
 	//methods for range computation
 	static void computeRangeAsymmetric(DW1000Device* myDistantDevice, DW1000Time* myTOF);
@@ -191,7 +191,8 @@ double DW1000Time::getAsMeters() const {
  * @return
  */
 DW1000Time& DW1000Time::wrap() {
-	if(_timestamp < 0) {
+	// negative values are stored as two's complement
+	if((int64_t)_timestamp < 0) {
 		_timestamp += TIME_OVERFLOW;
 	}
 	return *this;
@@ -202,7 +203,7 @@ DW1000Time& DW1000Time::wrap() {
  * @return true if valid, false if negative or overflow (maybe after calculation)
  */
 bool DW1000Time::isValidTimestamp() {
-	return (0 <= _timestamp && _timestamp <= TIME_MAX);
+	return ((int64_t)_timestamp >= 0 && _timestamp <= TIME_MAX);
 }
 
 // assign
@@ -301,7 +302,7 @@ void DW1000Time::print() {
  * @return size of printed chars
  */
 size_t DW1000Time::printTo(Print& p) const {
-	uint64_t       number  = _timestamp;
+	int64_t       number  = (int64_t)_timestamp;
 	unsigned char buf[21];
 	uint8_t       i       = 0;
 	uint8_t       printed = 0;
@@ -316,7 +317,7 @@ size_t DW1000Time::printTo(Print& p) const {
 		printed++;
 	}
 	while(number > 0) {
-		uint64_t q = number/10;
+		int64_t q = number/10;
 		buf[i++] = number-q*10;
 		number = q;
 	}